@@ -0,0 +1,361 @@
+/*
+ * Micro-benchmarks of hot code paths
+ *
+ * Each benchmark calls one function in isolation on synthetic input of a
+ * given size, such as thousands of views or a large rc.xml, and writes one
+ * line of CSV to stdout:
+ *
+ *   benchmark,size,iterations,total_ns,mean_ns
+ *
+ * Run with 'meson test --benchmark' or on its own. Functions that need a
+ * renderer (arrange_layers, osd_update, font_texture_create) are covered by
+ * the LABWC_DEBUG_TIMING probes instead.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <libxml/parser.h>
+#include <pixman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/backend/headless.h>
+#include <wlr/util/log.h>
+#include "config/keybind.h"
+#include "config/rcxml.h"
+#include "labwc.h"
+#include "ssd.h"
+#include "theme.h"
+#include "xbm/parse.h"
+#include "xbm/tokenize.h"
+
+/* normally defined in main.c, which is not linked in */
+struct rcxml rc = { 0 };
+
+#define OUTPUT_WIDTH (1920)
+#define OUTPUT_HEIGHT (1080)
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void
+report(const char *name, int size, int iterations, uint64_t total_ns)
+{
+	printf("%s,%d,%d,%lu,%lu\n", name, size, iterations,
+		(unsigned long)total_ns,
+		(unsigned long)(total_ns / iterations));
+}
+
+/* a desktop of @nr_views decorated views on one headless output */
+struct desktop {
+	struct wl_display *display;
+	struct wlr_backend *backend;
+	struct theme theme;
+	struct output output;
+	struct server server;
+	struct view *views;
+	struct wlr_xdg_surface *xdg_surfaces;
+	struct wlr_surface *surfaces;
+};
+
+static void
+desktop_init(struct desktop *desktop, int nr_views)
+{
+	memset(desktop, 0, sizeof(*desktop));
+	desktop->display = wl_display_create();
+	desktop->backend = wlr_headless_backend_create(desktop->display);
+	struct wlr_output *wlr_output = wlr_headless_add_output(
+		desktop->backend, OUTPUT_WIDTH, OUTPUT_HEIGHT);
+
+	desktop->theme.border_width = 1;
+	desktop->theme.title_height = 20;
+
+	struct server *server = &desktop->server;
+	server->theme = &desktop->theme;
+	server->output_layout = wlr_output_layout_create();
+	wlr_output_layout_add(server->output_layout, wlr_output, 0, 0);
+	wl_list_init(&server->outputs);
+	wl_list_init(&server->views);
+
+	struct output *output = &desktop->output;
+	output->server = server;
+	output->wlr_output = wlr_output;
+	for (int i = 0; i < 4; i++) {
+		wl_list_init(&output->layers[i]);
+	}
+	wl_list_insert(&server->outputs, &output->link);
+
+	/* keep the top-left corner free, so that a hit-test there misses */
+	srand(1);
+	desktop->views = calloc(nr_views, sizeof(struct view));
+	desktop->xdg_surfaces = calloc(nr_views, sizeof(struct wlr_xdg_surface));
+	desktop->surfaces = calloc(nr_views, sizeof(struct wlr_surface));
+	server->mapped_views = calloc(nr_views, sizeof(struct view *));
+	for (int i = 0; i < nr_views; i++) {
+		struct view *view = &desktop->views[i];
+		view->server = server;
+		view->type = LAB_XDG_SHELL_VIEW;
+		view->mapped = true;
+		view->ssd.enabled = true;
+		view->x = 200 + rand() % (OUTPUT_WIDTH - 600);
+		view->y = 200 + rand() % (OUTPUT_HEIGHT - 600);
+		view->w = 100 + rand() % 300;
+		view->h = 100 + rand() % 300;
+
+		/*
+		 * Just enough of a surface for wlr_xdg_surface_surface_at(): no
+		 * popups or subsurfaces, and an input region the view's size
+		 */
+		struct wlr_surface *surface = &desktop->surfaces[i];
+		wl_list_init(&surface->subsurfaces_below);
+		wl_list_init(&surface->subsurfaces_above);
+		surface->current.width = view->w;
+		surface->current.height = view->h;
+		pixman_region32_init_rect(&surface->input_region, 0, 0,
+			view->w, view->h);
+		struct wlr_xdg_surface *xdg_surface = &desktop->xdg_surfaces[i];
+		wl_list_init(&xdg_surface->popups);
+		xdg_surface->surface = surface;
+		view->surface = surface;
+		view->xdg_surface = xdg_surface;
+
+		wl_list_insert(server->views.prev, &view->link);
+		server->mapped_views[i] = view;
+	}
+	server->nr_mapped_views = nr_views;
+	server->mapped_views_alloc = nr_views;
+}
+
+static void
+desktop_finish(struct desktop *desktop)
+{
+	for (int i = 0; i < desktop->server.nr_mapped_views; i++) {
+		pixman_region32_fini(&desktop->surfaces[i].input_region);
+	}
+	free(desktop->server.mapped_views);
+	free(desktop->surfaces);
+	free(desktop->xdg_surfaces);
+	free(desktop->views);
+	wlr_output_layout_destroy(desktop->server.output_layout);
+	wlr_backend_destroy(desktop->backend);
+	wl_display_destroy(desktop->display);
+}
+
+/* the worst case: a point on the output that no view covers */
+static void
+bench_view_at(int nr_views, int iterations)
+{
+	struct desktop desktop;
+	desktop_init(&desktop, nr_views);
+
+	uint64_t start = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		struct wlr_surface *surface = NULL;
+		double sx, sy;
+		int view_area = LAB_SSD_NONE;
+		desktop_view_at(&desktop.server, 10, 10, &surface, &sx, &sy,
+			&view_area);
+	}
+	report("desktop_view_at", nr_views, iterations, now_ns() - start);
+	desktop_finish(&desktop);
+}
+
+static void
+bench_ssd(int nr_views, int iterations)
+{
+	struct desktop desktop;
+	desktop_init(&desktop, nr_views);
+
+	uint64_t start = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		struct view *view = &desktop.views[i % nr_views];
+		ssd_at(view, view->x + view->w - 5, view->y - 5);
+	}
+	report("ssd_at", nr_views, iterations, now_ns() - start);
+
+	start = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		struct view *view = &desktop.views[i % nr_views];
+		for (int type = LAB_SSD_BUTTON_CLOSE;
+				type < LAB_SSD_END_MARKER; type++) {
+			ssd_box(view, type);
+		}
+	}
+	report("ssd_box", nr_views, iterations, now_ns() - start);
+	desktop_finish(&desktop);
+}
+
+static const char *modifier_prefixes[] = {
+	"", "S-", "C-", "A-", "W-", "C-S-", "A-S-", "W-S-", "C-A-", "C-W-",
+	"A-W-", "C-A-S-", "C-W-S-", "A-W-S-", "C-A-W-", "C-A-W-S-",
+};
+
+static void
+keybind_name(char *buf, size_t len, int i)
+{
+	int nr_prefixes = sizeof(modifier_prefixes) / sizeof(char *);
+	int key = i / nr_prefixes;
+	const char *prefix = modifier_prefixes[i % nr_prefixes];
+	if (key < 26) {
+		snprintf(buf, len, "%s%c", prefix, 'a' + key);
+	} else {
+		snprintf(buf, len, "%sF%d", prefix, 1 + (key - 26) % 24);
+	}
+}
+
+/* a key combination no binding uses, so the whole table is searched */
+static void
+bench_keybind(int nr_keybinds, int iterations)
+{
+	struct wl_list keybinds;
+	wl_list_init(&keybinds);
+	char name[64];
+	for (int i = 0; i < nr_keybinds; i++) {
+		keybind_name(name, sizeof(name), i);
+		keybind_create(&keybinds, name);
+	}
+
+	uint64_t start = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		keybind_find(&keybinds, WLR_MODIFIER_MOD5, XKB_KEY_Hyper_L);
+	}
+	report("handle_keybinding", nr_keybinds, iterations,
+		now_ns() - start);
+
+	struct keybind *k, *next;
+	wl_list_for_each_safe (k, next, &keybinds, link) {
+		wl_list_remove(&k->link);
+		free(k->keysyms);
+		free(k);
+	}
+}
+
+/*
+ * rcxml_load() caches the path of the first file it reads, so every size is
+ * written to the same @path, which is only removed after the last run.
+ */
+static void
+bench_rcxml(const char *path, int nr_keybinds, int iterations)
+{
+	FILE *stream = fopen(path, "w");
+	if (!stream) {
+		perror(path);
+		return;
+	}
+	fprintf(stream, "<openbox_config>\n"
+		"<core><decoration>server</decoration></core>\n"
+		"<theme><name>Clearlooks</name><cornerRadius>8</cornerRadius>\n"
+		"<font place=\"ActiveWindow\"><name>sans</name>"
+		"<size>10</size></font></theme>\n"
+		"<focus><followMouse>yes</followMouse></focus>\n"
+		"<keyboard>\n");
+	char name[64];
+	for (int i = 0; i < nr_keybinds; i++) {
+		keybind_name(name, sizeof(name), i);
+		fprintf(stream, "<keybind key=\"%s\"><action name=\"Execute\">"
+			"<command>foot -e command-%d</command></action>"
+			"</keybind>\n", name, i);
+	}
+	fprintf(stream, "</keyboard>\n</openbox_config>\n");
+	fclose(stream);
+
+	uint64_t total = 0;
+	for (int i = 0; i < iterations; i++) {
+		struct rcxml config;
+		uint64_t start = now_ns();
+		rcxml_load(&config, path);
+		total += now_ns() - start;
+		rcxml_free(&config);
+	}
+	report("rcxml_read", nr_keybinds, iterations, total);
+}
+
+/* an xbm icon of @size x @size pixels */
+static char *
+xbm_create(int size)
+{
+	int nr_bytes = (size + 7) / 8 * size;
+	size_t len = 128 + nr_bytes * 6;
+	char *buf = malloc(len);
+	if (!buf) {
+		return NULL;
+	}
+	int pos = snprintf(buf, len, "#define icon_width %d\n"
+		"#define icon_height %d\n"
+		"static unsigned char icon_bits[] = {\n", size, size);
+	for (int i = 0; i < nr_bytes; i++) {
+		pos += snprintf(buf + pos, len - pos, "0x%02x,", (i * 37) & 0xff);
+	}
+	snprintf(buf + pos, len - pos, "};\n");
+	return buf;
+}
+
+static void
+bench_xbm(int size, int iterations)
+{
+	char *src = xbm_create(size);
+	if (!src) {
+		return;
+	}
+	size_t len = strlen(src) + 1;
+	char *buf = malloc(len);
+	if (!buf) {
+		free(src);
+		return;
+	}
+	float color[4] = { 1.0, 1.0, 1.0, 1.0 };
+	parse_set_color(color);
+
+	uint64_t tokenize_ns = 0, parse_ns = 0;
+	for (int i = 0; i < iterations; i++) {
+		memcpy(buf, src, len);
+		uint64_t start = now_ns();
+		struct token *tokens = tokenize_xbm(buf);
+		uint64_t mid = now_ns();
+		struct pixmap pixmap = parse_xbm_tokens(tokens);
+		parse_ns += now_ns() - mid;
+		tokenize_ns += mid - start;
+		free(pixmap.data);
+		free(tokens);
+	}
+	report("tokenize_xbm", size, iterations, tokenize_ns);
+	report("parse_xbm_tokens", size, iterations, parse_ns);
+	free(buf);
+	free(src);
+}
+
+int
+main(int argc, char *argv[])
+{
+	wlr_log_init(WLR_ERROR, NULL);
+	xmlInitParser();
+
+	printf("benchmark,size,iterations,total_ns,mean_ns\n");
+	int sizes[] = { 10, 100, 1000, 5000 };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		bench_view_at(sizes[i], 1000);
+		bench_ssd(sizes[i], 100000);
+		bench_keybind(sizes[i], 10000);
+	}
+	char path[] = "/tmp/labwc-bench-rc-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		perror("mkstemp");
+	} else {
+		close(fd);
+		bench_rcxml(path, 10, 100);
+		bench_rcxml(path, 1000, 20);
+		unlink(path);
+	}
+	bench_xbm(6, 10000);
+	bench_xbm(256, 100);
+
+	xmlCleanupParser();
+	return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __LABWC_ATLAS_H
+#define __LABWC_ATLAS_H
+
+#include <stdint.h>
+
+struct wlr_renderer;
+struct wlr_texture;
+
+/* area of an atlas texture in pixels */
+struct atlas_region {
+	int x, y, width, height;
+};
+
+struct atlas;
+
+/**
+ * atlas_create - start packing small images into a single texture
+ */
+struct atlas *atlas_create(void);
+
+/**
+ * atlas_add - copy image into atlas
+ * @region: set to the area the image will occupy in the texture
+ * @data: ARGB8888 pixels
+ * @stride: number of bytes per row of @data
+ */
+void atlas_add(struct atlas *atlas, struct atlas_region *region,
+	const uint32_t *data, int width, int height, int stride);
+
+/**
+ * atlas_finish - create texture from all images added and free atlas
+ * Returns NULL if no images were added or the texture cannot be created
+ */
+struct wlr_texture *atlas_finish(struct atlas *atlas,
+	struct wlr_renderer *renderer);
+
+/**
+ * atlas_destroy - free atlas without creating a texture
+ */
+void atlas_destroy(struct atlas *atlas);
+
+#endif /* __LABWC_ATLAS_H */
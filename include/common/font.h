@@ -1,6 +1,8 @@
 #ifndef __LABWC_FONT_H
 #define __LABWC_FONT_H
 
+#include <cairo.h>
+
 struct server;
 struct wlr_texture;
 struct wlr_box;
@@ -19,10 +21,49 @@ int font_height(const char *font_description);
  * @text: text to be generated as texture
  * @font: font description
  * @color: foreground color in rgba format
+ * Note: the texture is rasterized at server->text_scale
  */
 void font_texture_create(struct server *server, struct wlr_texture **texture,
 	int max_width, const char *text, const char *font, float *color);
 
+/**
+ * font_texture_create_async - create texture without blocking event loop
+ * @done: called (with @data) once the request has completed, which
+ * normally means *@texture has been replaced
+ * Note: text is rasterized on a worker thread and uploaded from the main
+ * loop. The old texture is kept until then. A newer request for the same
+ * @texture supersedes any pending one. Falls back to font_texture_create()
+ * if the worker thread cannot be started.
+ */
+void font_texture_create_async(struct server *server,
+	struct wlr_texture **texture, int max_width, const char *text,
+	const char *font, float *color, void (*done)(void *data), void *data);
+
+/**
+ * font_texture_render_async - draw texture contents on the worker thread
+ * @render: returns a new ARGB32 image surface drawn from @args
+ * @free_args: called to free @args once the request has completed
+ * Note: @render runs on the worker thread so must only use @args and not
+ * touch any compositor state. font_texture_create_async() is built on this.
+ */
+void font_texture_render_async(struct server *server,
+	struct wlr_texture **texture, cairo_surface_t *(*render)(void *args),
+	void *args, void (*free_args)(void *args), void (*done)(void *data),
+	void *data);
+
+/**
+ * font_texture_cancel - drop pending asynchronous requests for @texture
+ * Note: must be called before the memory holding @texture is freed
+ */
+void font_texture_cancel(struct wlr_texture **texture);
+
+/**
+ * font_texture_size - size of texture in layout coordinates
+ * Note: textures are created at server->text_scale
+ */
+void font_texture_size(struct server *server, struct wlr_texture *texture,
+	int *width, int *height);
+
 /**
  * font_finish - free some font related resources
  * Note: use on exit
@@ -10,7 +10,9 @@
 /**
  * grab_file - read file into memory buffer
  * @filename: file to read
- * Returns pointer to buffer. Free with free().
+ * Returns pointer to NUL-terminated buffer with the whole file in it, or
+ * NULL if the file cannot be read. Free with free().
+ * Note: the file is read in one go rather than line by line
  */
 char *grab_file(const char *filename);
 
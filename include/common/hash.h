@@ -0,0 +1,32 @@
+/*
+ * Hash config files to tell whether they have changed
+ *
+ * 64-bit FNV-1a. Hashes can be chained by passing the result of one call as
+ * @hash to the next; start with HASH_INIT.
+ */
+
+#ifndef __LABWC_HASH_H
+#define __LABWC_HASH_H
+
+#include <stdint.h>
+
+#define HASH_INIT (0xcbf29ce484222325ULL)
+
+/**
+ * hash_str - add string to hash
+ * Note: NULL is hashed differently from ""
+ */
+uint64_t hash_str(uint64_t hash, const char *s);
+
+/**
+ * hash_int - add integer to hash
+ */
+uint64_t hash_int(uint64_t hash, int n);
+
+/**
+ * hash_file - add contents of file to hash
+ * Note: a missing file is hashed differently from an empty one
+ */
+uint64_t hash_file(uint64_t hash, const char *filename);
+
+#endif /* __LABWC_HASH_H */
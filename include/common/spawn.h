@@ -7,4 +7,12 @@
  */
 void spawn_async_no_shell(char const *command);
 
+/**
+ * spawn_piped - execute asyncronously with stdout connected to a pipe
+ * @command: command to be executed
+ * Returns the non-blocking read end of the pipe, or -1 on failure. The
+ * caller closes it when done.
+ */
+int spawn_piped(char const *command);
+
 #endif /* __LABWC_SPAWN_H */
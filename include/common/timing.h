@@ -0,0 +1,33 @@
+/*
+ * Lightweight timing of hot code paths
+ *
+ * Timing is only enabled when the environment variable LABWC_DEBUG_TIMING is
+ * set to a filename. Statistics are accumulated per probe and written to
+ * that file in CSV format by timing_finish().
+ */
+
+#ifndef __LABWC_TIMING_H
+#define __LABWC_TIMING_H
+
+#include <stdint.h>
+
+/**
+ * timing_begin - start timing a code path
+ * Returns start time in nanoseconds, or 0 if timing is disabled
+ */
+uint64_t timing_begin(void);
+
+/**
+ * timing_end - record time elapsed since timing_begin()
+ * @name: probe name; must be a string literal or otherwise outlive the probe
+ * @start: value returned by timing_begin()
+ */
+void timing_end(const char *name, uint64_t start);
+
+/**
+ * timing_finish - write statistics to file and reset all probes
+ * Note: use on exit
+ */
+void timing_finish(void);
+
+#endif /* __LABWC_TIMING_H */
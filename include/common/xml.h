@@ -0,0 +1,56 @@
+/*
+ * Stream xml documents to handlers looked up by node name
+ *
+ * Nodes are named like nodename() used to, innermost first and in lower
+ * case, but without the root element. For example, the command in
+ * <openbox_config><keyboard><keybind><action><command> is reported as
+ * "command.action.keybind.keyboard". Attributes are named like child
+ * elements, so <keybind key=""> gives "key.keybind.keyboard".
+ *
+ * For documents with recursive structure, names can be made to stop at the
+ * innermost element of a given name (see struct xml_parser::scope).
+ */
+
+#ifndef __LABWC_XML_H
+#define __LABWC_XML_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * struct xml_path - handlers for the node at a path
+ * @path: node name as described above
+ * @handler: called with the text or attribute value; may be NULL
+ * @start: called when an element starts, before its attributes; may be NULL
+ * @end: called when an element ends; may be NULL
+ * All are called with xml_parser::data.
+ */
+struct xml_path {
+	const char *path;
+	void (*handler)(const char *content, void *data);
+	void (*start)(void *data);
+	void (*end)(void *data);
+};
+
+struct xml_parser {
+	const struct xml_path *paths;
+	int nr_paths;
+	/* if set, names stop at the innermost element with this name */
+	const char *scope;
+	void *data;
+	/* print the name and content of every node */
+	bool debug;
+};
+
+/**
+ * xml_read - parse xml in @buf, calling handlers for matching nodes
+ * @url: file name used in libxml2 error messages; may be NULL
+ * Returns false if the document is not well formed. Handlers may have been
+ * called for the part before the error.
+ * Note: the document is streamed rather than built into a tree, so memory
+ * use does not grow with the size of the document
+ */
+bool xml_read(struct xml_parser *parser, const char *buf, size_t len,
+	const char *url);
+
+#endif /* __LABWC_XML_H */
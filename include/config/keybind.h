@@ -15,8 +15,17 @@ struct keybind {
 
 /**
  * keybind_create - parse keybind and add to linked list
+ * @keybinds: list to add to, for example rc.keybinds
  * @keybind: key combination
  */
-struct keybind *keybind_create(const char *keybind);
+struct keybind *keybind_create(struct wl_list *keybinds, const char *keybind);
+
+/**
+ * keybind_find - find the keybind for key combination
+ * @keybinds: list to search, for example rc.keybinds
+ * Note: bindings added last take precedence
+ */
+struct keybind *keybind_find(struct wl_list *keybinds, uint32_t modifiers,
+	xkb_keysym_t sym);
 
 #endif /* __LABWC_KEYBIND_H */
@@ -2,6 +2,7 @@
 #define __LABWC_RCXML_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <wayland-server-core.h>
 
@@ -9,6 +10,7 @@
 
 struct rcxml {
 	bool xdg_shell_server_side_deco;
+	int idle_timeout; /* seconds; 0 to never power off outputs */
 	bool focus_follow_mouse;
 	bool raise_on_focus;
 	char *theme_name;
@@ -24,4 +26,30 @@ void rcxml_parse_xml(struct buf *b);
 void rcxml_read(const char *filename);
 void rcxml_finish(void);
 
+/**
+ * rcxml_load - read config file into @config
+ * @filename: only respected the first time a config is read
+ * Note: @config is reset to defaults first. The global rc is not touched,
+ * so this can be used to read a new config off the event loop.
+ * Returns false if rc.xml is malformed, in which case @config holds what
+ * was read up to the error and still has to be freed.
+ */
+bool rcxml_load(struct rcxml *config, const char *filename);
+
+/**
+ * rcxml_hash - hash contents of rc.xml to tell whether it has changed
+ */
+uint64_t rcxml_hash(void);
+
+/**
+ * rcxml_free - free strings and keybinds of @config
+ */
+void rcxml_free(struct rcxml *config);
+
+/**
+ * rcxml_replace - make @config the global rc, freeing the previous one
+ * Note: the contents of @config are moved and it is left empty
+ */
+void rcxml_replace(struct rcxml *config);
+
 #endif /* __LABWC_RCXML_H */
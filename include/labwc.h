@@ -36,6 +36,8 @@
 #include <xkbcommon/xkbcommon.h>
 #include "config/keybind.h"
 #include "config/rcxml.h"
+#include "ssd.h"
+#include "stats.h"
 
 #define XCURSOR_DEFAULT "left_ptr"
 #define XCURSOR_SIZE 24
@@ -99,6 +101,11 @@ struct server {
 #endif
 
 	struct wl_list views;
+
+	/* mapped views in stacking order, topmost first */
+	struct view **mapped_views;
+	int nr_mapped_views;
+	int mapped_views_alloc;
 	struct wl_list unmanaged_surfaces;
 
 	struct seat seat;
@@ -108,10 +115,14 @@ struct server {
 	struct view *grabbed_view;
 	double grab_x, grab_y;
 	struct wlr_box grab_box;
+
+	/* titlebar button under the cursor, empty if none */
+	struct wlr_box ssd_hover_box;
 	uint32_t resize_edges;
 	struct wlr_texture *osd;
 
 	struct wl_list outputs;
+	uint32_t output_bits; /* output::bit of all outputs */
 	struct wl_listener new_output;
 	struct wlr_output_layout *output_layout;
 
@@ -122,11 +133,23 @@ struct server {
 
 	struct wlr_foreign_toplevel_manager_v1 *foreign_toplevel_manager;
 
+	struct wlr_idle *idle;
+	struct wlr_idle_inhibit_manager_v1 *idle_inhibit_manager;
+	struct wl_listener new_idle_inhibitor;
+	struct wl_list idle_inhibitors;
+	struct wl_event_source *idle_timer;
+	bool idle_timer_armed;
+	struct timespec idle_last_activity;
+	bool outputs_powered_off;
+
 	/* Set when in cycle (alt-tab) mode */
 	struct view *cycle_view;
 
 	struct theme *theme;
 	struct menu *rootmenu;
+
+	/* highest output scale; text textures are rasterized at this scale */
+	float text_scale;
 };
 
 struct output {
@@ -136,6 +159,12 @@ struct output {
 	struct wlr_output_damage *damage;
 	struct wl_list layers[4];
 	struct wlr_box usable_area;
+	bool powered_off; /* by idle timeout */
+	uint32_t bit; /* in view::outputs; 0 if there are too many outputs */
+
+	/* schedules a frame when an occluded view is due a frame callback */
+	struct wl_event_source *hidden_frame_timer;
+	bool hidden_frame_pending;
 
 	struct wl_listener destroy;
 	struct wl_listener damage_frame;
@@ -161,6 +190,7 @@ struct view_impl {
 	void (*move)(struct view *view, double x, double y);
 	void (*unmap)(struct view *view);
 	void (*maximize)(struct view *view, bool maximize);
+	void (*minimize)(struct view *view, bool minimize);
 };
 
 struct border {
@@ -186,12 +216,30 @@ struct view {
 
 	bool mapped;
 	bool been_mapped;
+	uint32_t trace_id;	/* assigned by trace_view() */
 	bool minimized;
 	bool maximized;
 
+	/* last frame done sent whilst occluded by other views */
+	struct timespec hidden_frame_done;
+
+	/* nothing to render in the current frame; see cull_views() */
+	bool culled;
+
+	/*
+	 * area covered by all surfaces, popups and decorations, and the part
+	 * of it which is opaque, in layout coordinates; kept up to date by
+	 * view_update_regions() so that rendering need not work them out
+	 */
+	pixman_region32_t extents;
+	pixman_region32_t opaque;
+
 	/* geometry of the wlr_surface contained within the view */
 	int x, y, w, h;
 
+	/* output::bit of the outputs the view is on; see view_update_outputs() */
+	uint32_t outputs;
+
 	/* geometry before maximize */
 	struct wlr_box unmaximized_geometry;
 
@@ -220,11 +268,15 @@ struct view {
 
 	struct {
 		bool enabled;
-		struct wl_list parts;
+		/* in rendering order; see ssd_create() */
+		struct ssd_part parts[SSD_MAX_PARTS];
+		int nr_parts;
 		struct wlr_box box; /* remember geo so we know when to update */
 	} ssd;
 	struct wlr_texture *title;
 
+	struct commit_stats stats;
+
 	struct wlr_foreign_toplevel_handle_v1 *toplevel_handle;
 	struct wl_listener toplevel_handle_request_maximize;
 	struct wl_listener toplevel_handle_request_minimize;
@@ -248,6 +300,7 @@ struct xwayland_unmanaged {
 	struct wlr_xwayland_surface *xwayland_surface;
 	struct wl_list link;
 	int lx, ly;
+	struct commit_stats stats;
 
 	struct wl_listener request_configure;
 	struct wl_listener commit;
@@ -260,6 +313,8 @@ struct xwayland_unmanaged {
 struct view_child {
 	struct wlr_surface *surface;
 	struct view *parent;
+	/* area covered when last damaged, in layout coordinates */
+	struct wlr_box damaged;
 	struct wl_listener commit;
 	struct wl_listener new_subsurface;
 };
@@ -295,6 +350,20 @@ void xwayland_unmanaged_create(struct server *server,
 void view_child_init(struct view_child *child, struct view *view,
 	struct wlr_surface *wlr_surface);
 void view_child_finish(struct view_child *child);
+
+/**
+ * view_child_damage - damage popup or subsurface at its own position
+ * @whole: damage the whole surface tree rather than what was committed
+ * Note: if the child has moved or changed size since it was last damaged,
+ * the area it covered then is damaged too
+ */
+void view_child_damage(struct view_child *child, bool whole);
+
+/**
+ * view_child_damage_unmap - damage the area the child last covered
+ * Note: call on unmap, as the surface may no longer have a buffer
+ */
+void view_child_damage_unmap(struct view_child *child);
 void subsurface_create(struct view *view, struct wlr_subsurface *wlr_subsurface);
 
 void view_move_resize(struct view *view, struct wlr_box geo);
@@ -305,6 +374,13 @@ struct wlr_output *view_wlr_output(struct view *view);
 void view_center(struct view *view);
 void view_maximize(struct view *view, bool maximize);
 void view_toggle_maximize(struct view *view);
+
+/**
+ * view_arrange_maximized - fit maximized views to the output's usable area
+ * Note: called when the usable area changes; only views whose geometry
+ * differs are sent a configure
+ */
+void view_arrange_maximized(struct output *output);
 void view_for_each_surface(struct view *view,
 	wlr_surface_iterator_func_t iterator, void *user_data);
 void view_for_each_popup_surface(struct view *view,
@@ -312,8 +388,59 @@ void view_for_each_popup_surface(struct view *view,
 void view_move_to_edge(struct view *view, const char *direction);
 void view_update_title(struct view *view);
 
+/**
+ * view_update_regions - recalculate view::extents and view::opaque
+ * Note: call when the view or one of its popups or subsurfaces has been
+ * mapped, unmapped, moved or committed, or its decorations have changed
+ */
+void view_update_regions(struct view *view);
+
+/**
+ * view_update_outputs - work out which outputs the view is on
+ * Note: sends wl_surface enter/leave to the view's surfaces. Call after the
+ * view has been mapped, unmapped, moved or resized, and when the output
+ * layout has changed.
+ */
+void view_update_outputs(struct view *view);
+
+/**
+ * view_surface_enter_outputs - send enter for the outputs @view is on
+ * @surface: popup or subsurface tree created after the view entered them
+ */
+void view_surface_enter_outputs(struct view *view, struct wlr_surface *surface);
+
+/* view_on_output - whether damage or frames on @output concern @view */
+bool view_on_output(struct view *view, struct output *output);
+
 void foreign_toplevel_handle_create(struct view *view);
 
+void idle_init(struct server *server);
+void idle_finish(struct server *server);
+/**
+ * idle_notify_activity - reset idle timers and power on outputs
+ * Note: call on user input
+ */
+void idle_notify_activity(struct seat *seat);
+
+/**
+ * idle_reset_timer - restart the idle timeout from now
+ * Note: call when rc.idle_timeout changes
+ */
+void idle_reset_timer(struct server *server);
+
+/**
+ * idle_update_inhibit - re-check which idle inhibitors are in effect
+ * Note: call when a view is mapped or unmapped, as inhibitors only count
+ * for surfaces that can be seen
+ */
+void idle_update_inhibit(struct server *server);
+
+/**
+ * desktop_restack - rebuild server->mapped_views from server->views
+ * Note: call whenever a view is mapped, unmapped, destroyed or moved in the
+ * stacking order
+ */
+void desktop_restack(struct server *server);
 void desktop_set_focus_view_only(struct seat *seat, struct view *view);
 void desktop_focus_view(struct seat *seat, struct view *view);
 
@@ -335,6 +462,7 @@ struct view *desktop_view_at(struct server *server, double lx, double ly,
 	struct wlr_surface **surface, double *sx, double *sy, int *view_area);
 
 void cursor_init(struct seat *seat);
+void process_cursor_motion(struct server *server, uint32_t time);
 
 void keyboard_init(struct seat *seat);
 
@@ -347,6 +475,13 @@ void interactive_begin(struct view *view, enum input_mode mode,
 		      uint32_t edges);
 
 void output_init(struct server *server);
+
+/**
+ * output_update_scaled_textures - create theme images for the scales of
+ * all outputs, and re-create text textures if the highest scale changed
+ * Note: called on output layout change, and when the theme is replaced
+ */
+void output_update_scaled_textures(struct server *server);
 void output_damage_surface(struct output *output, struct wlr_surface *surface,
 	double lx, double ly, bool whole);
 void scale_box(struct wlr_box *box, float scale);
@@ -359,10 +494,22 @@ void damage_all_outputs(struct server *server);
 void damage_view_whole(struct view *view);
 void damage_view_part(struct view *view);
 
+/* damage_box - damage @box, in layout coordinates, on all outputs */
+void damage_box(struct server *server, struct wlr_box *box);
+
 void server_init(struct server *server);
 void server_start(struct server *server);
 void server_finish(struct server *server);
 
+void reload_init(struct server *server);
+void reload_finish(struct server *server);
+/**
+ * reload_config_and_theme - re-read rc.xml, themerc and menu.xml
+ * Note: files are read and images rasterized off the event loop, and the
+ * current config, theme and menu stay in use until the new ones are ready
+ */
+void reload_config_and_theme(struct server *server);
+
 void action(struct server *server, const char *action, const char *command);
 
 /* update onscreen display 'alt-tab' texture */
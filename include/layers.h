@@ -2,6 +2,7 @@
 #define __LABWC_LAYERS_H
 #include <wayland-server.h>
 #include <wlr/types/wlr_layer_shell_v1.h>
+#include "stats.h"
 
 struct server;
 
@@ -15,8 +16,33 @@ struct lab_layer_surface {
 	struct wl_listener unmap;
 	struct wl_listener surface_commit;
 	struct wl_listener output_destroy;
+	struct wl_listener new_popup;
 
 	struct wlr_box geo;
+	struct commit_stats stats;
+
+	/* size last sent to the client; only re-sent when it changes */
+	bool configured;
+	int configured_width;
+	int configured_height;
+
+	/* state last arranged with; other commits only need damage */
+	struct wlr_layer_surface_v1_state arranged;
+	bool arranged_mapped;
+};
+
+struct lab_layer_popup {
+	struct wlr_xdg_popup *wlr_popup;
+	/* the layer surface at the root of the popup tree */
+	struct lab_layer_surface *layer;
+	/* area covered when last damaged, in layout coordinates */
+	struct wlr_box damaged;
+
+	struct wl_listener commit;
+	struct wl_listener map;
+	struct wl_listener unmap;
+	struct wl_listener destroy;
+	struct wl_listener new_popup;
 };
 
 void layers_init(struct server *server);
@@ -5,8 +5,10 @@
 #include <wlr/render/wlr_renderer.h>
 
 struct menuitem {
+	char *label;
 	char *action;
 	char *command;
+	struct menu *submenu; /* shown while the item is selected */
 	struct wlr_box box;
 	struct {
 		struct wlr_texture *active;
@@ -22,21 +24,90 @@ struct menu {
 	struct server *server;
 	struct wlr_box box;
 	struct wl_list menuitems;
+
+	/* menuitems top to bottom, indexed when the menu is moved */
+	struct menuitem **items;
+	int nr_items;
+	struct menuitem *selected;
+
+	char *id;
+	char *label;
+
+	/* submenu shown next to this menu */
+	struct menu *open;
+
+	/* root menu only: all other menus, which it owns */
+	struct wl_list menus;
+	struct wl_list link; /* menu::menus */
+
+	/* pipe menus are filled with the output of @execute when opened */
+	char *execute;
+	struct {
+		int fd;
+		struct wl_event_source *source;
+		char *buf;
+		size_t len;
+		size_t alloc;
+		uint64_t updated_ms;
+	} pipe;
+
+	/* pipe menu whose output defined this menu, if any */
+	struct menu *pipe_parent;
+	bool doomed;
 };
 
 void menu_init_rootmenu(struct server *server, struct menu *menu);
 void menu_finish(struct menu *menu);
 
-/* menu_move - move to position (x, y) */
+/**
+ * menu_load - read menu.xml into @menu without creating textures
+ * Note: does not touch any compositor state, so can run off the event loop
+ * Returns false if menu.xml is malformed; @menu must still be finished.
+ */
+bool menu_load(struct menu *menu);
+
+/**
+ * menu_hash - hash menu.xml to tell whether it has changed
+ */
+uint64_t menu_hash(void);
+
+/**
+ * menu_replace - free the menus of @menu and move those of @new into it
+ */
+void menu_replace(struct menu *menu, struct menu *new);
+
+/**
+ * menu_texture_create - create textures needed to show the menu
+ * Note: item textures are only created on first show, and for the
+ * highlighted variant on first hover
+ */
+void menu_texture_create(struct menu *menu);
+
+/**
+ * menu_texture_invalidate - drop textures after font, theme or scale change
+ * Note: textures are re-created straight away if the menu is being shown
+ */
+void menu_texture_invalidate(struct menu *menu);
+
+/**
+ * menu_move - move to position (x, y)
+ * Note: closes any submenu and clears the selection, so call when showing
+ * the menu
+ */
 void menu_move(struct menu *menu, int x, int y);
 
-/* menu_set_selected - select item at (x, y) */
+/**
+ * menu_set_selected - select item at (x, y)
+ * Note: selecting an item with a submenu opens it, and runs the command
+ * of a pipe menu unless its output from the last 30 seconds can be used.
+ * Only items whose selection changed are damaged.
+ */
 void menu_set_selected(struct menu *menu, int x, int y);
 
-/* menu_action_selected - select item at (x, y) */
-void menu_action_selected(struct server *server, struct menu *menu);
-
-/* menu_reconfigure - reload theme and content */
-void menu_reconfigure(struct server *server, struct menu *menu);
+/**
+ * menu_action_selected - run the action of the item under the cursor
+ * Return true if the item opens a submenu, so the menu stays open
+ */
+bool menu_action_selected(struct server *server, struct menu *menu);
 
 #endif /* __LABWC_MENU_H */
@@ -1,6 +1,7 @@
 #ifndef __LABWC_SSD_H
 #define __LABWC_SSD_H
 
+
 /*
  * Sequence these according to the order they should be processes for
  * press and hover events. Bear in mind that some of their respective
@@ -46,10 +47,11 @@ struct ssd_part {
 		float *active;
 		float *inactive;
 	} color;
-
-	struct wl_list link;
 };
 
+/* border (4), titlebar, title and two top corners */
+#define SSD_MAX_PARTS (8)
+
 struct view;
 
 struct border ssd_thickness(struct view *view);
@@ -57,6 +59,7 @@ struct wlr_box ssd_max_extents(struct view *view);
 struct wlr_box ssd_box(struct view *view, enum ssd_part_type type);
 enum ssd_part_type ssd_at(struct view *view, double lx, double ly);
 uint32_t ssd_resize_edges(enum ssd_part_type type);
+bool ssd_is_button(enum ssd_part_type type);
 void ssd_update_title(struct view *view);
 void ssd_create(struct view *view);
 void ssd_destroy(struct view *view);
@@ -0,0 +1,56 @@
+/*
+ * Per-client commit pacing statistics
+ *
+ * Used to identify clients which commit, damage, change title or respond to
+ * configure events at an unreasonable rate. Statistics are written to stdout
+ * and reset by the Debug action.
+ */
+
+#ifndef __LABWC_STATS_H
+#define __LABWC_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+struct server;
+struct wlr_surface;
+
+struct commit_stats {
+	struct timespec since;
+	uint32_t commits;
+	uint64_t damage_area;
+	uint32_t title_changes;
+
+	/* configure round-trip */
+	uint32_t configure_serial;
+	struct timespec configure_sent;
+	uint32_t configures_acked;
+	uint64_t configure_latency_ms;
+	uint32_t configure_latency_max_ms;
+};
+
+/**
+ * stats_commit - count commit and its effective damage
+ */
+void stats_commit(struct commit_stats *stats, struct wlr_surface *surface);
+
+/**
+ * stats_configure_sent - start timing configure round-trip
+ * @serial: configure serial
+ */
+void stats_configure_sent(struct commit_stats *stats, uint32_t serial);
+
+/**
+ * stats_configure_acked - stop timing configure round-trip
+ * @serial: most recent serial acked and committed by client
+ */
+void stats_configure_acked(struct commit_stats *stats, uint32_t serial);
+
+void stats_title_changed(struct commit_stats *stats);
+
+/**
+ * stats_dump - print statistics for all surfaces to stdout and reset them
+ */
+void stats_dump(struct server *server);
+
+#endif /* __LABWC_STATS_H */
@@ -8,7 +8,43 @@
 #define __LABWC_THEME_H
 
 #include <stdio.h>
+#include <wayland-server-core.h>
 #include <wlr/render/wlr_renderer.h>
+#include "common/atlas.h"
+
+enum button_state {
+	LAB_BUTTON_UNPRESSED = 0,
+	LAB_BUTTON_HOVER,
+	LAB_BUTTON_PRESSED,
+	LAB_BUTTON_STATE_COUNT
+};
+
+/* theme images rasterized for one output scale */
+struct theme_assets {
+	float scale;
+
+	/* buttons and corners below are regions of this texture */
+	struct wlr_texture *atlas;
+
+	/* images not yet uploaded, when rasterized off the event loop */
+	struct atlas *pending;
+
+	/* indexed by enum button_state */
+	struct atlas_region xbm_close_active[LAB_BUTTON_STATE_COUNT];
+	struct atlas_region xbm_maximize_active[LAB_BUTTON_STATE_COUNT];
+	struct atlas_region xbm_iconify_active[LAB_BUTTON_STATE_COUNT];
+
+	struct atlas_region xbm_close_inactive[LAB_BUTTON_STATE_COUNT];
+	struct atlas_region xbm_maximize_inactive[LAB_BUTTON_STATE_COUNT];
+	struct atlas_region xbm_iconify_inactive[LAB_BUTTON_STATE_COUNT];
+
+	struct atlas_region corner_top_left_active_normal;
+	struct atlas_region corner_top_right_active_normal;
+	struct atlas_region corner_top_left_inactive_normal;
+	struct atlas_region corner_top_right_inactive_normal;
+
+	struct wl_list link; /* theme::assets */
+};
 
 struct theme {
 	int border_width;
@@ -27,42 +63,81 @@ struct theme {
 	float window_inactive_button_iconify_unpressed_image_color[4];
 	float window_inactive_button_max_unpressed_image_color[4];
 	float window_inactive_button_close_unpressed_image_color[4];
-	/* TODO: add pressed and hover colors for buttons */
+	float window_active_button_hover_image_color[4];
+	float window_active_button_pressed_image_color[4];
+	float window_inactive_button_hover_image_color[4];
+	float window_inactive_button_pressed_image_color[4];
+	/* unset hover and pressed colors follow the unpressed ones */
+	bool window_active_button_hover_set;
+	bool window_active_button_pressed_set;
+	bool window_inactive_button_hover_set;
+	bool window_inactive_button_pressed_set;
 
 	float menu_items_bg_color[4];
 	float menu_items_text_color[4];
 	float menu_items_active_bg_color[4];
 	float menu_items_active_text_color[4];
 
-	struct wlr_texture *xbm_close_active_unpressed;
-	struct wlr_texture *xbm_maximize_active_unpressed;
-	struct wlr_texture *xbm_iconify_active_unpressed;
-
-	struct wlr_texture *xbm_close_inactive_unpressed;
-	struct wlr_texture *xbm_maximize_inactive_unpressed;
-	struct wlr_texture *xbm_iconify_inactive_unpressed;
+	struct wlr_renderer *renderer;
+	struct wl_list assets; /* struct theme_assets, one per output scale */
 
-	struct wlr_texture *corner_top_left_active_normal;
-	struct wlr_texture *corner_top_right_active_normal;
-	struct wlr_texture *corner_top_left_inactive_normal;
-	struct wlr_texture *corner_top_right_inactive_normal;
+	/* copied from the config the theme was read for */
+	char *name;
+	int corner_radius;
 
 	/* not set in rc.xml/themerc, but derived from font & padding_height */
 	int title_height;
 };
 
+struct rcxml;
+
 /**
- * theme_init - read openbox theme and generate button textures
+ * theme_init - read openbox theme set in rc.theme_name
  * @theme: theme data
  * @renderer: wlr_renderer for creating button textures
- * @theme_name: theme-name in <theme-dir>/<theme-name>/openbox-3/themerc
- * Note <theme-dir> is obtained in theme-dir.c
+ * Note: the theme is read from <theme-dir>/<theme-name>/openbox-3/themerc
+ * and <theme-dir> is obtained in theme-dir.c
+ */
+void theme_init(struct theme *theme, struct wlr_renderer *renderer);
+
+/**
+ * theme_load - read theme for @config and rasterize images for @scales
+ * Note: no textures are created and no global state is touched, so this
+ * can be run off the event loop. Images are uploaded on first use after
+ * the theme has been installed with theme_replace().
+ */
+void theme_load(struct theme *theme, struct rcxml *config, float *scales,
+	int nr_scales);
+
+/**
+ * theme_hash - hash all inputs of theme_load() to tell whether they changed
+ * Note: covers themerc, the xbm files and the theme settings of @config
+ */
+uint64_t theme_hash(struct rcxml *config);
+
+/**
+ * theme_replace - free @theme and move @new into its place
+ * Note: @theme keeps its renderer
+ */
+void theme_replace(struct theme *theme, struct theme *new);
+
+/**
+ * theme_assets_get - get button and corner images for output scale
+ * Returns NULL if there are none for @scale; see theme_assets_update()
+ * Note: images are uploaded on first use, but never read or rasterized here
+ */
+struct theme_assets *theme_assets_get(struct theme *theme, float scale);
+
+/**
+ * theme_assets_update - create images for new scales and free unused ones
+ * @scales: scales of all outputs
+ * Note: call when the output layout changes, so that rendering does not
+ * have to read xbm files
  */
-void theme_init(struct theme *theme, struct wlr_renderer *renderer,
-		const char *theme_name);
+void theme_assets_update(struct theme *theme, float *scales, int nr_scales);
 
 /**
- * theme_finish - free button textures
+ * theme_finish - free images for all scales
  * @theme: theme data
  */
 void theme_finish(struct theme *theme);
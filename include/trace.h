@@ -0,0 +1,66 @@
+/*
+ * Record and replay traces of input and client events
+ *
+ * A trace is a compact binary file consisting of a short header followed by
+ * fixed-size records in host byte order. Input events can be replayed into
+ * the compositor, for example on the headless backend, to reproduce issues
+ * deterministically. Client (view) events are recorded for analysis only as
+ * they cannot be re-created without the clients themselves.
+ */
+
+#ifndef __LABWC_TRACE_H
+#define __LABWC_TRACE_H
+
+#include <stdint.h>
+
+struct server;
+struct view;
+
+enum trace_type {
+	TRACE_NONE = 0,
+	TRACE_CURSOR_MOTION,	/* layout x, y (wl_fixed_t) */
+	TRACE_CURSOR_BUTTON,	/* button, state */
+	TRACE_CURSOR_AXIS,	/* orientation | source << 16, delta, discrete */
+	TRACE_CURSOR_FRAME,
+	TRACE_KEY,		/* keycode, state */
+	TRACE_VIEW_MAP,		/* view-id */
+	TRACE_VIEW_UNMAP,	/* view-id */
+	TRACE_VIEW_COMMIT,	/* view-id, width, height */
+	TRACE_VIEW_CONFIGURE,	/* view-id, width, height */
+	TRACE_VIEW_SET_TITLE,	/* view-id */
+};
+
+/**
+ * trace_record_init - start recording events to file
+ * @filename: trace file to be created
+ */
+void trace_record_init(const char *filename);
+
+/**
+ * trace_input - record input event
+ * Note: no-op unless trace_record_init() has been called
+ */
+void trace_input(enum trace_type type, int32_t a, int32_t b, int32_t c);
+
+/**
+ * trace_view - record view lifecycle event
+ * Note: no-op unless trace_record_init() has been called
+ */
+void trace_view(struct view *view, enum trace_type type, int32_t a, int32_t b);
+
+/**
+ * trace_replay - feed input events from trace file into compositor
+ * @server: server to feed events into
+ * @filename: trace file previously recorded with trace_record_init()
+ * Events are replayed with their original timing. The compositor exits when
+ * the last event has been replayed.
+ */
+void trace_replay(struct server *server, const char *filename);
+
+/**
+ * trace_finish - flush and close trace file
+ * Note: use on exit
+ */
+void trace_finish(void);
+
+#endif /* __LABWC_TRACE_H */
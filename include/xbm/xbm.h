@@ -1,13 +1,24 @@
 #ifndef __LABWC_XBM_H
 #define __LABWC_XBM_H
 
-#include <wlr/render/wlr_renderer.h>
-
+#include <stdint.h>
+#include "common/atlas.h"
 #include "xbm/parse.h"
 
+struct theme;
+struct theme_assets;
+
+/**
+ * xbm_load - add theme xbm button images to atlas
+ * Note: images are scaled to assets->scale and their atlas regions stored
+ * in @assets
+ */
+void xbm_load(struct theme *theme, struct theme_assets *assets,
+	struct atlas *atlas);
+
 /**
- * xbm_load - load theme xbm files into global theme struct
+ * xbm_hash - add contents of theme xbm files to @hash
  */
-void xbm_load(struct theme *theme, struct wlr_renderer *renderer);
+uint64_t xbm_hash(uint64_t hash, const char *theme_name);
 
 #endif /* __LABWC_XBM_H */
@@ -14,6 +14,7 @@ show_menu(struct server *server, const char *menu)
 		server->input_mode = LAB_INPUT_STATE_MENU;
 		menu_move(server->rootmenu, server->seat.cursor->x,
 			server->seat.cursor->y);
+		menu_texture_create(server->rootmenu);
 	}
 	damage_all_outputs(server);
 }
@@ -29,7 +30,7 @@ action(struct server *server, const char *action, const char *command)
 			view->impl->close(view);
 		}
 	} else if (!strcasecmp(action, "Debug")) {
-		/* nothing */
+		stats_dump(server);
 	} else if (!strcasecmp(action, "Execute")) {
 		struct buf cmd;
 		buf_init(&cmd);
@@ -46,7 +47,7 @@ action(struct server *server, const char *action, const char *command)
 			desktop_cycle_view(server, server->cycle_view);
 		osd_update(server);
 	} else if (!strcasecmp(action, "Reconfigure")) {
-		spawn_async_no_shell("killall -SIGHUP labwc");
+		reload_config_and_theme(server);
 	} else if (!strcasecmp(action, "ShowMenu")) {
 		show_menu(server, command);
 	} else if (!strcasecmp(action, "ToggleMaximize")) {
@@ -0,0 +1,134 @@
+/*
+ * Pack theme icons into one texture
+ *
+ * Button icons and titlebar corners are drawn for every decorated view, so
+ * keeping them in a single texture means decorations can be rendered
+ * without switching textures. Images are simply placed side by side as
+ * there are only a few dozen of them, all small.
+ */
+
+#include <drm_fourcc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/util/log.h>
+#include "common/atlas.h"
+
+/* keep images apart so that linear filtering does not bleed between them */
+#define ATLAS_GAP (1)
+
+struct atlas_image {
+	struct atlas_region region;
+	uint32_t *data;
+};
+
+struct atlas {
+	struct atlas_image *images;
+	int nr_images;
+	int alloc;
+	int width, height;
+};
+
+struct atlas *
+atlas_create(void)
+{
+	return calloc(1, sizeof(struct atlas));
+}
+
+void
+atlas_add(struct atlas *atlas, struct atlas_region *region,
+		const uint32_t *data, int width, int height, int stride)
+{
+	memset(region, 0, sizeof(*region));
+	if (!atlas || !data || width <= 0 || height <= 0) {
+		return;
+	}
+	/* on failure, leave the region empty so that the image is skipped */
+	if (atlas->nr_images == atlas->alloc) {
+		int alloc = (atlas->alloc + 16) * 2;
+		struct atlas_image *images = realloc(atlas->images,
+			alloc * sizeof(struct atlas_image));
+		if (!images) {
+			wlr_log(WLR_ERROR, "cannot grow atlas");
+			return;
+		}
+		atlas->images = images;
+		atlas->alloc = alloc;
+	}
+	struct atlas_image *image = &atlas->images[atlas->nr_images];
+	image->data = malloc(width * height * sizeof(uint32_t));
+	if (!image->data) {
+		wlr_log(WLR_ERROR, "cannot add %dx%d image to atlas", width,
+			height);
+		return;
+	}
+	atlas->nr_images++;
+	for (int row = 0; row < height; row++) {
+		memcpy(image->data + row * width,
+			(const uint8_t *)data + row * stride,
+			width * sizeof(uint32_t));
+	}
+
+	region->x = atlas->width ? atlas->width + ATLAS_GAP : 0;
+	region->y = 0;
+	region->width = width;
+	region->height = height;
+	image->region = *region;
+
+	atlas->width = region->x + width;
+	if (height > atlas->height) {
+		atlas->height = height;
+	}
+}
+
+void
+atlas_destroy(struct atlas *atlas)
+{
+	if (!atlas) {
+		return;
+	}
+	for (int i = 0; i < atlas->nr_images; i++) {
+		free(atlas->images[i].data);
+	}
+	free(atlas->images);
+	free(atlas);
+}
+
+struct wlr_texture *
+atlas_finish(struct atlas *atlas, struct wlr_renderer *renderer)
+{
+	if (!atlas) {
+		return NULL;
+	}
+	struct wlr_texture *texture = NULL;
+	if (!atlas->nr_images) {
+		goto out;
+	}
+
+	uint32_t *pixels = calloc(atlas->width * atlas->height,
+		sizeof(uint32_t));
+	if (!pixels) {
+		wlr_log(WLR_ERROR, "cannot allocate %dx%d atlas",
+			atlas->width, atlas->height);
+		goto out;
+	}
+	for (int i = 0; i < atlas->nr_images; i++) {
+		struct atlas_region *r = &atlas->images[i].region;
+		for (int row = 0; row < r->height; row++) {
+			memcpy(pixels + (r->y + row) * atlas->width + r->x,
+				atlas->images[i].data + row * r->width,
+				r->width * sizeof(uint32_t));
+		}
+	}
+	texture = wlr_texture_from_pixels(renderer, DRM_FORMAT_ARGB8888,
+		atlas->width * sizeof(uint32_t), atlas->width, atlas->height,
+		pixels);
+	if (!texture) {
+		wlr_log(WLR_ERROR, "cannot create %dx%d atlas texture",
+			atlas->width, atlas->height);
+	}
+	free(pixels);
+out:
+	atlas_destroy(atlas);
+	return texture;
+}
@@ -130,7 +130,7 @@ config_dir(void)
 char *
 theme_dir(const char *theme_name)
 {
-	static char buf[4096] = { 0 };
+	static _Thread_local char buf[4096] = { 0 };
 	struct ctx ctx = { .build_path_fn = build_theme_path,
 			   .buf = buf,
 			   .len = sizeof(buf),
@@ -1,10 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include <cairo.h>
 #include <drm_fourcc.h>
+#include <math.h>
 #include <pango/pangocairo.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/util/box.h>
 #include <wlr/util/log.h>
 #include "common/font.h"
+#include "common/timing.h"
 #include "labwc.h"
 
 static PangoRectangle
@@ -47,26 +55,27 @@ font_height(const char *font_description)
 	return rectangle.height;
 }
 
-void
-font_texture_create(struct server *server, struct wlr_texture **texture,
-		int max_width, const char *text, const char *font, float *color)
+/*
+ * rasterize - render text into a new image surface
+ * @scale: output scale to rasterize for; layout is in layout coordinates
+ * Note: this does not touch any compositor state and is therefore also
+ * used by the worker thread. Pango uses a separate font map per thread.
+ */
+static cairo_surface_t *
+rasterize(const char *text, const char *font, float *color, int max_width,
+		float scale)
 {
-	if (!text || !*text) {
-		return;
-	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
-	}
-
 	PangoRectangle rect = font_extents(font, text);
 	if (max_width && rect.width > max_width) {
 		rect.width = max_width;
 	}
 
+	int width = ceil(rect.width * scale);
+	int height = ceil(rect.height * scale);
 	cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-		rect.width, rect.height);
+		width, height);
 	cairo_t *cairo = cairo_create(surf);
+	cairo_scale(cairo, scale, scale);
 
 	cairo_set_source_rgba(cairo, color[0], color[1], color[2], color[3]);
 	cairo_move_to(cairo, 0, 0);
@@ -84,14 +93,365 @@ font_texture_create(struct server *server, struct wlr_texture **texture,
 	pango_cairo_show_layout(cairo, layout);
 	g_object_unref(layout);
 
+	cairo_destroy(cairo);
 	cairo_surface_flush(surf);
-	unsigned char *data = cairo_image_surface_get_data(surf);
-	*texture = wlr_texture_from_pixels(server->renderer, DRM_FORMAT_ARGB8888,
-			cairo_image_surface_get_stride(surf), rect.width,
-			rect.height, data);
+	return surf;
+}
 
-	cairo_destroy(cairo);
+static struct wlr_texture *
+texture_from_surface(struct wlr_renderer *renderer, cairo_surface_t *surf)
+{
+	return wlr_texture_from_pixels(renderer, DRM_FORMAT_ARGB8888,
+		cairo_image_surface_get_stride(surf),
+		cairo_image_surface_get_width(surf),
+		cairo_image_surface_get_height(surf),
+		cairo_image_surface_get_data(surf));
+}
+
+void
+font_texture_create(struct server *server, struct wlr_texture **texture,
+		int max_width, const char *text, const char *font, float *color)
+{
+	if (!text || !*text) {
+		return;
+	}
+	uint64_t start = timing_begin();
+	font_texture_cancel(texture);
+	if (*texture) {
+		wlr_texture_destroy(*texture);
+		*texture = NULL;
+	}
+
+	/* lay out in layout coordinates, but rasterize for output scale */
+	cairo_surface_t *surf = rasterize(text, font, color, max_width,
+		server->text_scale);
+	*texture = texture_from_surface(server->renderer, surf);
 	cairo_surface_destroy(surf);
+	timing_end("font_texture_create", start);
+}
+
+enum job_state {
+	JOB_QUEUED = 0,
+	JOB_RUNNING,
+	JOB_DONE,
+};
+
+struct font_job {
+	enum job_state state;
+	bool cancelled;
+
+	/* main thread only */
+	struct wlr_texture **texture;
+	void (*done)(void *data);
+	void *data;
+
+	/* input */
+	cairo_surface_t *(*render)(void *args);
+	void *args;
+	void (*free_args)(void *args);
+
+	/* output */
+	cairo_surface_t *surf;
+
+	struct wl_list link; /* worker.jobs */
+};
+
+struct text_args {
+	char *text;
+	char *font;
+	float color[4];
+	int max_width;
+	float scale;
+};
+
+/*
+ * Rasterization jobs are queued on worker.jobs and picked up by a single
+ * worker thread. When a job is done, the worker writes to an eventfd so
+ * that the main loop can upload the image as a texture - wlr_renderer
+ * must only be used from the main thread. worker.mutex protects the job
+ * list and job state.
+ */
+static struct {
+	bool running;
+	bool quit;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct wl_list jobs;
+	int eventfd;
+	struct wl_event_source *source;
+	struct wlr_renderer *renderer;
+	struct wl_listener display_destroy;
+} worker = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+	.eventfd = -1,
+};
+
+static void
+job_destroy(struct font_job *job)
+{
+	if (job->surf) {
+		cairo_surface_destroy(job->surf);
+	}
+	if (job->free_args) {
+		job->free_args(job->args);
+	}
+	free(job);
+}
+
+static struct font_job *
+next_queued_job(void)
+{
+	struct font_job *job;
+	wl_list_for_each (job, &worker.jobs, link) {
+		if (job->state == JOB_QUEUED) {
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void *
+worker_run(void *data)
+{
+	pthread_mutex_lock(&worker.mutex);
+	while (!worker.quit) {
+		struct font_job *job = next_queued_job();
+		if (!job) {
+			pthread_cond_wait(&worker.cond, &worker.mutex);
+			continue;
+		}
+		job->state = JOB_RUNNING;
+		pthread_mutex_unlock(&worker.mutex);
+
+		cairo_surface_t *surf = job->render(job->args);
+
+		pthread_mutex_lock(&worker.mutex);
+		job->surf = surf;
+		job->state = JOB_DONE;
+		uint64_t one = 1;
+		if (write(worker.eventfd, &one, sizeof(one)) < 0) {
+			/* counter already non-zero, so main loop will wake */
+		}
+	}
+	pthread_mutex_unlock(&worker.mutex);
+	return NULL;
+}
+
+static struct font_job *
+take_done_job(void)
+{
+	struct font_job *job, *found = NULL;
+	pthread_mutex_lock(&worker.mutex);
+	wl_list_for_each (job, &worker.jobs, link) {
+		if (job->state == JOB_DONE) {
+			wl_list_remove(&job->link);
+			found = job;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&worker.mutex);
+	return found;
+}
+
+static int
+handle_jobs_done(int fd, uint32_t mask, void *data)
+{
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0) {
+		/* spurious wake-up */
+	}
+
+	/*
+	 * Take one job at a time because done() callbacks may cancel other
+	 * jobs, which must therefore still be on worker.jobs
+	 */
+	struct font_job *job;
+	while ((job = take_done_job())) {
+		if (job->cancelled) {
+			job_destroy(job);
+			continue;
+		}
+		struct wlr_texture *texture =
+			texture_from_surface(worker.renderer, job->surf);
+		if (texture) {
+			/* the old texture stays on screen until now */
+			if (*job->texture) {
+				wlr_texture_destroy(*job->texture);
+			}
+			*job->texture = texture;
+		}
+		if (job->done) {
+			job->done(job->data);
+		}
+		job_destroy(job);
+	}
+	return 0;
+}
+
+static void
+worker_stop(void)
+{
+	if (!worker.running) {
+		return;
+	}
+	pthread_mutex_lock(&worker.mutex);
+	worker.quit = true;
+	pthread_cond_broadcast(&worker.cond);
+	pthread_mutex_unlock(&worker.mutex);
+	pthread_join(worker.thread, NULL);
+
+	struct font_job *job, *next;
+	wl_list_for_each_safe (job, next, &worker.jobs, link) {
+		wl_list_remove(&job->link);
+		job_destroy(job);
+	}
+	wl_event_source_remove(worker.source);
+	close(worker.eventfd);
+	wl_list_remove(&worker.display_destroy.link);
+	worker.eventfd = -1;
+	worker.running = false;
+}
+
+static void
+handle_display_destroy(struct wl_listener *listener, void *data)
+{
+	worker_stop();
+}
+
+static bool
+worker_start(struct server *server)
+{
+	worker.eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (worker.eventfd < 0) {
+		wlr_log_errno(WLR_ERROR, "eventfd()");
+		return false;
+	}
+	wl_list_init(&worker.jobs);
+	worker.quit = false;
+	if (pthread_create(&worker.thread, NULL, worker_run, NULL)) {
+		wlr_log(WLR_ERROR, "cannot create font rasterization thread");
+		close(worker.eventfd);
+		worker.eventfd = -1;
+		return false;
+	}
+
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(server->wl_display);
+	worker.source = wl_event_loop_add_fd(event_loop, worker.eventfd,
+		WL_EVENT_READABLE, handle_jobs_done, NULL);
+	worker.renderer = server->renderer;
+	worker.display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(server->wl_display,
+		&worker.display_destroy);
+	worker.running = true;
+	return true;
+}
+
+void
+font_texture_render_async(struct server *server, struct wlr_texture **texture,
+		cairo_surface_t *(*render)(void *args), void *args,
+		void (*free_args)(void *args), void (*done)(void *data),
+		void *data)
+{
+	if (!worker.running && !worker_start(server)) {
+		cairo_surface_t *surf = render(args);
+		if (*texture) {
+			wlr_texture_destroy(*texture);
+		}
+		*texture = texture_from_surface(server->renderer, surf);
+		cairo_surface_destroy(surf);
+		if (free_args) {
+			free_args(args);
+		}
+		if (done) {
+			done(data);
+		}
+		return;
+	}
+
+	/* only the most recent request for a texture matters */
+	font_texture_cancel(texture);
+
+	struct font_job *job = calloc(1, sizeof(*job));
+	job->texture = texture;
+	job->done = done;
+	job->data = data;
+	job->render = render;
+	job->args = args;
+	job->free_args = free_args;
+
+	pthread_mutex_lock(&worker.mutex);
+	wl_list_insert(worker.jobs.prev, &job->link);
+	pthread_cond_signal(&worker.cond);
+	pthread_mutex_unlock(&worker.mutex);
+}
+
+static cairo_surface_t *
+render_text(void *data)
+{
+	struct text_args *args = data;
+	return rasterize(args->text, args->font, args->color,
+		args->max_width, args->scale);
+}
+
+static void
+free_text_args(void *data)
+{
+	struct text_args *args = data;
+	free(args->text);
+	free(args->font);
+	free(args);
+}
+
+void
+font_texture_create_async(struct server *server, struct wlr_texture **texture,
+		int max_width, const char *text, const char *font, float *color,
+		void (*done)(void *data), void *data)
+{
+	if (!text || !*text) {
+		return;
+	}
+	struct text_args *args = calloc(1, sizeof(*args));
+	args->text = strdup(text);
+	args->font = strdup(font);
+	memcpy(args->color, color, sizeof(args->color));
+	args->max_width = max_width;
+	args->scale = server->text_scale;
+	font_texture_render_async(server, texture, render_text, args,
+		free_text_args, done, data);
+}
+
+void
+font_texture_cancel(struct wlr_texture **texture)
+{
+	if (!worker.running) {
+		return;
+	}
+	struct font_job *job, *next;
+	pthread_mutex_lock(&worker.mutex);
+	wl_list_for_each_safe (job, next, &worker.jobs, link) {
+		if (job->texture != texture) {
+			continue;
+		}
+		if (job->state == JOB_QUEUED) {
+			wl_list_remove(&job->link);
+			job_destroy(job);
+		} else {
+			/* freed by handle_jobs_done() */
+			job->cancelled = true;
+		}
+	}
+	pthread_mutex_unlock(&worker.mutex);
+}
+
+void
+font_texture_size(struct server *server, struct wlr_texture *texture,
+		int *width, int *height)
+{
+	*width = round(texture->width / server->text_scale);
+	*height = round(texture->height / server->text_scale);
 }
 
 void
@@ -6,29 +6,48 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include "common/grab-file.h"
-#include "common/buf.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 
 char *
 grab_file(const char *filename)
 {
-	char *line = NULL;
-	size_t len = 0;
 	FILE *stream = fopen(filename, "r");
 	if (!stream) {
 		return NULL;
 	}
-	struct buf buffer;
-	buf_init(&buffer);
-	while ((getline(&line, &len, stream) != -1)) {
-		char *p = strrchr(line, '\n');
-		if (p) {
-			*p = '\0';
+
+	/*
+	 * The size is only a hint as the file may change whilst being read.
+	 * Leave room for one more byte than expected so that a short read
+	 * tells us we have reached the end without another fread().
+	 */
+	struct stat st;
+	size_t alloc = 4096;
+	if (!fstat(fileno(stream), &st) && st.st_size > 0) {
+		alloc = st.st_size + 2;
+	}
+	char *buf = malloc(alloc);
+	size_t len = 0;
+	while (buf) {
+		size_t want = alloc - len - 1;
+		size_t n = fread(buf + len, 1, want, stream);
+		len += n;
+		if (n < want) {
+			break;
+		}
+		alloc *= 2;
+		char *p = realloc(buf, alloc);
+		if (!p) {
+			free(buf);
 		}
-		buf_add(&buffer, line);
+		buf = p;
 	}
-	free(line);
 	fclose(stream);
-	return (buffer.buf);
+	if (buf) {
+		buf[len] = '\0';
+	}
+	return buf;
 }
@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <string.h>
+#include "common/hash.h"
+
+#define FNV_PRIME (0x100000001b3ULL)
+
+static uint64_t
+hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+uint64_t
+hash_str(uint64_t hash, const char *s)
+{
+	if (!s) {
+		return hash_bytes(hash, "\xff", 1);
+	}
+	/* include terminator so that "ab","c" differs from "a","bc" */
+	return hash_bytes(hash, s, strlen(s) + 1);
+}
+
+uint64_t
+hash_int(uint64_t hash, int n)
+{
+	return hash_bytes(hash, &n, sizeof(n));
+}
+
+uint64_t
+hash_file(uint64_t hash, const char *filename)
+{
+	FILE *stream = fopen(filename, "r");
+	if (!stream) {
+		return hash_bytes(hash, "\xff", 1);
+	}
+	char buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), stream)) > 0) {
+		hash = hash_bytes(hash, buf, len);
+	}
+	fclose(stream);
+	return hash_bytes(hash, "", 1);
+}
@@ -1,37 +0,0 @@
-#include <ctype.h>
-#include <string.h>
-#include "common/nodename.h"
-
-char *
-nodename(xmlNode *node, char *buf, int len)
-{
-	if (!node || !node->name) {
-		return NULL;
-	}
-
-	/* Ignore superflous 'text.' in node name */
-	if (node->parent && !strcmp((char *)node->name, "text")) {
-		node = node->parent;
-	}
-
-	char *p = buf;
-	p[--len] = 0;
-	for (;;) {
-		const char *name = (char *)node->name;
-		char c;
-		while ((c = *name++) != 0) {
-			*p++ = tolower(c);
-			if (!--len)
-				return buf;
-		}
-		*p = 0;
-		node = node->parent;
-		if (!node || !node->name) {
-			return buf;
-		}
-		*p++ = '.';
-		if (!--len) {
-			return buf;
-		}
-	}
-}
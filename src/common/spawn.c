@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <fcntl.h>
 #include <glib.h>
 #include <signal.h>
 #include <stdint.h>
@@ -10,8 +11,9 @@
 #include <wlr/util/log.h>
 #include "common/spawn.h"
 
-void
-spawn_async_no_shell(char const *command)
+/* run command in a double-forked grandchild with stdout set to @out_fd */
+static void
+spawn(char const *command, int out_fd)
 {
 	GError *err = NULL;
 	gchar **argv = NULL;
@@ -44,6 +46,9 @@ spawn_async_no_shell(char const *command)
 		sigprocmask(SIG_SETMASK, &set, NULL);
 		grandchild = fork();
 		if (grandchild == 0) {
+			if (out_fd >= 0) {
+				dup2(out_fd, STDOUT_FILENO);
+			}
 			execvp(argv[0], argv);
 			_exit(0);
 		} else if (grandchild < 0) {
@@ -58,3 +63,26 @@ out:
 	g_strfreev(argv);
 }
 
+void
+spawn_async_no_shell(char const *command)
+{
+	spawn(command, -1);
+}
+
+int
+spawn_piped(char const *command)
+{
+	int fds[2];
+	if (pipe(fds) < 0) {
+		wlr_log(WLR_ERROR, "unable to pipe()");
+		return -1;
+	}
+	/* only the grandchild's stdout should keep the write end open */
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	spawn(command, fds[1]);
+	close(fds[1]);
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	return fds[0];
+}
+
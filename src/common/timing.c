@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/util/log.h>
+#include "common/timing.h"
+
+#define MAX_PROBES (32)
+
+struct probe {
+	const char *name;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+};
+
+/* probes may be hit from worker threads as well as the event loop */
+static pthread_mutex_t probes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct probe probes[MAX_PROBES];
+static int nr_probes;
+
+static const char *
+timing_filename(void)
+{
+	static bool has_run;
+	static const char *filename;
+
+	if (!has_run) {
+		filename = getenv("LABWC_DEBUG_TIMING");
+		has_run = true;
+	}
+	return filename;
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static struct probe *
+probe_get(const char *name)
+{
+	for (int i = 0; i < nr_probes; i++) {
+		if (probes[i].name == name || !strcmp(probes[i].name, name)) {
+			return &probes[i];
+		}
+	}
+	if (nr_probes == MAX_PROBES) {
+		return NULL;
+	}
+	struct probe *probe = &probes[nr_probes++];
+	probe->name = name;
+	probe->min_ns = UINT64_MAX;
+	return probe;
+}
+
+uint64_t
+timing_begin(void)
+{
+	return timing_filename() ? now_ns() : 0;
+}
+
+void
+timing_end(const char *name, uint64_t start)
+{
+	if (!start) {
+		return;
+	}
+	uint64_t elapsed = now_ns() - start;
+	pthread_mutex_lock(&probes_mutex);
+	struct probe *probe = probe_get(name);
+	if (probe) {
+		probe->calls++;
+		probe->total_ns += elapsed;
+		if (elapsed < probe->min_ns) {
+			probe->min_ns = elapsed;
+		}
+		if (elapsed > probe->max_ns) {
+			probe->max_ns = elapsed;
+		}
+	}
+	pthread_mutex_unlock(&probes_mutex);
+}
+
+void
+timing_finish(void)
+{
+	const char *filename = timing_filename();
+	if (!filename || !nr_probes) {
+		return;
+	}
+	FILE *stream = fopen(filename, "w");
+	if (!stream) {
+		wlr_log(WLR_ERROR, "cannot write timing file (%s)", filename);
+		return;
+	}
+	fprintf(stream, "probe,calls,total_ns,min_ns,max_ns,mean_ns\n");
+	for (int i = 0; i < nr_probes; i++) {
+		struct probe *p = &probes[i];
+		fprintf(stream, "%s,%lu,%lu,%lu,%lu,%lu\n", p->name,
+			(unsigned long)p->calls, (unsigned long)p->total_ns,
+			(unsigned long)p->min_ns, (unsigned long)p->max_ns,
+			(unsigned long)(p->total_ns / p->calls));
+	}
+	fclose(stream);
+	memset(probes, 0, sizeof(probes));
+	nr_probes = 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Stream xml documents to handlers looked up by node name
+ *
+ * Node names are hashed so that each text or attribute is matched against
+ * the handlers with integer compares, and strcmp() only runs on a hit.
+ */
+
+#include <ctype.h>
+#include <libxml/xmlreader.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <wlr/util/log.h>
+#include "common/hash.h"
+#include "common/xml.h"
+
+/* deeper nodes are not reported; no config file nests this deep */
+#define XML_MAX_DEPTH (32)
+
+struct xml_walk {
+	/* element names from the root down, owned by the reader */
+	const char *names[XML_MAX_DEPTH];
+	int depth;
+
+	struct xml_parser *parser;
+	uint64_t *hashes;
+};
+
+static size_t
+path_add(char *buf, size_t pos, size_t len, const char *name)
+{
+	if (pos && pos < len - 1) {
+		buf[pos++] = '.';
+	}
+	for (; *name && pos < len - 1; name++) {
+		buf[pos++] = tolower((unsigned char)*name);
+	}
+	buf[pos] = '\0';
+	return pos;
+}
+
+/* name of the current node, innermost first; the root is left out */
+static void
+current_path(struct xml_walk *walk, const char *leaf, char *buf, size_t len)
+{
+	const char *scope = walk->parser->scope;
+	size_t pos = 0;
+	buf[0] = '\0';
+	if (leaf) {
+		pos = path_add(buf, pos, len, leaf);
+	}
+	for (int i = walk->depth - 1; i > 0; i--) {
+		pos = path_add(buf, pos, len, walk->names[i]);
+		if (scope && !strcasecmp(walk->names[i], scope)) {
+			break;
+		}
+	}
+}
+
+enum xml_event {
+	XML_EVENT_CONTENT = 0,
+	XML_EVENT_START,
+	XML_EVENT_END,
+};
+
+static void
+dispatch(struct xml_walk *walk, enum xml_event event, const char *leaf,
+		const char *content)
+{
+	struct xml_parser *parser = walk->parser;
+	if (walk->depth > XML_MAX_DEPTH) {
+		return;
+	}
+	if (event == XML_EVENT_CONTENT && !content) {
+		return;
+	}
+	char path[256];
+	current_path(walk, leaf, path, sizeof(path));
+	if (!path[0]) {
+		return;
+	}
+	if (parser->debug && event == XML_EVENT_CONTENT) {
+		printf("%s%s: %s\n", leaf ? "@" : "", path, content);
+	}
+	uint64_t hash = hash_str(HASH_INIT, path);
+	for (int i = 0; i < parser->nr_paths; i++) {
+		const struct xml_path *p = &parser->paths[i];
+		if (walk->hashes[i] != hash || strcmp(p->path, path)) {
+			continue;
+		}
+		if (event == XML_EVENT_CONTENT && p->handler) {
+			p->handler(content, parser->data);
+		} else if (event == XML_EVENT_START && p->start) {
+			p->start(parser->data);
+		} else if (event == XML_EVENT_END && p->end) {
+			p->end(parser->data);
+		}
+	}
+}
+
+static void
+element_start(struct xml_walk *walk, xmlTextReaderPtr reader)
+{
+	if (walk->depth < XML_MAX_DEPTH) {
+		walk->names[walk->depth] =
+			(const char *)xmlTextReaderConstName(reader);
+	}
+	++walk->depth;
+	dispatch(walk, XML_EVENT_START, NULL, NULL);
+	while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+		dispatch(walk, XML_EVENT_CONTENT,
+			(const char *)xmlTextReaderConstName(reader),
+			(const char *)xmlTextReaderConstValue(reader));
+	}
+	xmlTextReaderMoveToElement(reader);
+
+	/* <foo/> has no end element */
+	if (xmlTextReaderIsEmptyElement(reader)) {
+		dispatch(walk, XML_EVENT_END, NULL, NULL);
+		--walk->depth;
+	}
+}
+
+bool
+xml_read(struct xml_parser *parser, const char *buf, size_t len,
+		const char *url)
+{
+	xmlTextReaderPtr reader = xmlReaderForMemory(buf, len, url, NULL, 0);
+	if (!reader) {
+		return false;
+	}
+	struct xml_walk walk = {
+		.parser = parser,
+	};
+	walk.hashes = calloc(parser->nr_paths, sizeof(uint64_t));
+	if (!walk.hashes) {
+		xmlFreeTextReader(reader);
+		return false;
+	}
+	for (int i = 0; i < parser->nr_paths; i++) {
+		walk.hashes[i] = hash_str(HASH_INIT, parser->paths[i].path);
+	}
+
+	int ret;
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		switch (xmlTextReaderNodeType(reader)) {
+		case XML_READER_TYPE_ELEMENT:
+			element_start(&walk, reader);
+			break;
+		case XML_READER_TYPE_END_ELEMENT:
+			dispatch(&walk, XML_EVENT_END, NULL, NULL);
+			--walk.depth;
+			break;
+		case XML_READER_TYPE_TEXT:
+		case XML_READER_TYPE_CDATA:
+			dispatch(&walk, XML_EVENT_CONTENT, NULL,
+				(const char *)xmlTextReaderConstValue(reader));
+			break;
+		default:
+			/* whitespace, comments and processing instructions */
+			break;
+		}
+	}
+	free(walk.hashes);
+	xmlFreeTextReader(reader);
+	if (ret < 0) {
+		wlr_log(WLR_ERROR, "cannot parse %s", url ? url : "xml");
+	}
+	return ret == 0;
+}
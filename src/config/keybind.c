@@ -24,7 +24,7 @@ parse_modifier(const char *symname)
 }
 
 struct keybind *
-keybind_create(const char *keybind)
+keybind_create(struct wl_list *keybinds, const char *keybind)
 {
 	struct keybind *k = calloc(1, sizeof(struct keybind));
 	xkb_keysym_t keysyms[32];
@@ -51,8 +51,25 @@ keybind_create(const char *keybind)
 	if (!k) {
 		return NULL;
 	}
-	wl_list_insert(&rc.keybinds, &k->link);
+	wl_list_insert(keybinds, &k->link);
 	k->keysyms = malloc(k->keysyms_len * sizeof(xkb_keysym_t));
 	memcpy(k->keysyms, keysyms, k->keysyms_len * sizeof(xkb_keysym_t));
 	return k;
 }
+
+struct keybind *
+keybind_find(struct wl_list *keybinds, uint32_t modifiers, xkb_keysym_t sym)
+{
+	struct keybind *keybind;
+	wl_list_for_each_reverse (keybind, keybinds, link) {
+		if (modifiers ^ keybind->modifiers) {
+			continue;
+		}
+		for (size_t i = 0; i < keybind->keysyms_len; i++) {
+			if (sym == keybind->keysyms[i]) {
+				return keybind;
+			}
+		}
+	}
+	return NULL;
+}
@@ -3,7 +3,6 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <libxml/parser.h>
-#include <libxml/tree.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -12,14 +11,19 @@
 #include <wayland-server-core.h>
 #include <wlr/util/log.h>
 #include "common/dir.h"
-#include "common/nodename.h"
-#include "common/string-helpers.h"
+#include "common/grab-file.h"
+#include "common/hash.h"
+#include "common/timing.h"
+#include "common/xml.h"
 #include "common/zfree.h"
 #include "config/keybind.h"
 #include "config/rcxml.h"
 
-static bool in_keybind = false;
-static bool is_attribute = false;
+/* path of rc.xml, set the first time a config is read */
+static char rcxml[4096];
+
+/* config being parsed; only one config is parsed at a time */
+static struct rcxml *current_rc;
 static struct keybind *current_keybind;
 
 enum font_place {
@@ -29,31 +33,32 @@ enum font_place {
 	/* TODO: Add all places based on Openbox's rc.xml */
 };
 
+/* current <theme><font place=""></font></theme> */
+static enum font_place font_place;
+
 static void
-fill_keybind(char *nodename, char *content)
+keybind_key(const char *content, void *data)
 {
-	if (!content) {
-		return;
-	}
-	string_truncate_at_pattern(nodename, ".keybind.keyboard");
-	if (!strcmp(nodename, "key")) {
-		current_keybind = keybind_create(content);
-	}
-	/*
-	 * We expect <keybind key=""> to come first
-	 * If a invalid keybind has been provided, keybind_create() complains
-	 * so we just silently ignore it here.
-	 */
-	if (!current_keybind) {
-		return;
-	}
-	if (!strcmp(nodename, "name.action")) {
+	current_keybind = keybind_create(&current_rc->keybinds, content);
+}
+
+/*
+ * We expect <keybind key=""> to come first
+ * If a invalid keybind has been provided, keybind_create() complains
+ * so we just silently ignore it here.
+ */
+static void
+keybind_action(const char *content, void *data)
+{
+	if (current_keybind) {
 		current_keybind->action = strdup(content);
-	} else if (!strcmp(nodename, "command.action")) {
-		current_keybind->command = strdup(content);
-	} else if (!strcmp(nodename, "direction.action")) {
-		current_keybind->command = strdup(content);
-	} else if (!strcmp(nodename, "menu.action")) {
+	}
+}
+
+static void
+keybind_command(const char *content, void *data)
+{
+	if (current_keybind) {
 		current_keybind->command = strdup(content);
 	}
 }
@@ -74,189 +79,143 @@ get_bool(const char *s)
 }
 
 static void
-fill_font(char *nodename, char *content, enum font_place place)
+font_set_place(const char *content, void *data)
 {
-	if (!content) {
-		return;
-	}
-	string_truncate_at_pattern(nodename, ".font.theme");
-
-	switch (place) {
-	case FONT_PLACE_UNKNOWN:
-		/*
-		 * If <theme><font></font></theme> is used without a place=""
-		 * attribute, we set all font variables
-		 */
-		if (!strcmp(nodename, "name")) {
-			rc.font_name_activewindow = strdup(content);
-		} else if (!strcmp(nodename, "size")) {
-			rc.font_size_activewindow = atoi(content);
-		}
-		break;
-	case FONT_PLACE_ACTIVEWINDOW:
-		if (!strcmp(nodename, "name")) {
-			rc.font_name_activewindow = strdup(content);
-		} else if (!strcmp(nodename, "size")) {
-			rc.font_size_activewindow = atoi(content);
-		}
-		break;
-
-	/* TODO: implement for all font places */
-
-	default:
-		break;
+	if (!strcasecmp(content, "ActiveWindow")) {
+		font_place = FONT_PLACE_ACTIVEWINDOW;
+	} else if (!strcasecmp(content, "InactiveWindow")) {
+		font_place = FONT_PLACE_INACTIVEWINDOW;
+	} else {
+		font_place = FONT_PLACE_UNKNOWN;
 	}
 }
 
-static enum font_place
-enum_font_place(const char *place)
+/*
+ * If <theme><font></font></theme> is used without a place="" attribute, we
+ * set all font variables
+ * TODO: implement for all font places
+ */
+static void
+font_name(const char *content, void *data)
 {
-	if (!place) {
-		return FONT_PLACE_UNKNOWN;
-	}
-	if (!strcasecmp(place, "ActiveWindow")) {
-		return FONT_PLACE_ACTIVEWINDOW;
-	} else if (!strcasecmp(place, "InactiveWindow")) {
-		return FONT_PLACE_INACTIVEWINDOW;
+	if (font_place == FONT_PLACE_UNKNOWN
+			|| font_place == FONT_PLACE_ACTIVEWINDOW) {
+		current_rc->font_name_activewindow = strdup(content);
 	}
-	return FONT_PLACE_UNKNOWN;
 }
 
 static void
-entry(xmlNode *node, char *nodename, char *content)
+font_size(const char *content, void *data)
 {
-	/* current <theme><font place=""></font></theme> */
-	static enum font_place font_place = FONT_PLACE_UNKNOWN;
-
-	if (!nodename) {
-		return;
-	}
-	string_truncate_at_pattern(nodename, ".openbox_config");
-	string_truncate_at_pattern(nodename, ".labwc_config");
-
-	if (getenv("LABWC_DEBUG_CONFIG_NODENAMES")) {
-		if (is_attribute) {
-			printf("@");
-		}
-		printf("%s: %s\n", nodename, content);
-	}
-
-	if (!content) {
-		return;
-	}
-	if (in_keybind) {
-		fill_keybind(nodename, content);
-	}
-
-	if (is_attribute && !strcmp(nodename, "place.font.theme")) {
-		font_place = enum_font_place(content);
+	if (font_place == FONT_PLACE_UNKNOWN
+			|| font_place == FONT_PLACE_ACTIVEWINDOW) {
+		current_rc->font_size_activewindow = atoi(content);
 	}
+}
 
-	if (!strcmp(nodename, "decoration.core")) {
-		if (!strcmp(content, "client")) {
-			rc.xdg_shell_server_side_deco = false;
-		} else {
-			rc.xdg_shell_server_side_deco = true;
-		}
-	} else if (!strcmp(nodename, "name.theme")) {
-		rc.theme_name = strdup(content);
-	} else if (!strcmp(nodename, "cornerradius.theme")) {
-		rc.corner_radius = atoi(content);
-	} else if (!strcmp(nodename, "name.font.theme")) {
-		fill_font(nodename, content, font_place);
-	} else if (!strcmp(nodename, "size.font.theme")) {
-		fill_font(nodename, content, font_place);
-	} else if (!strcasecmp(nodename, "FollowMouse.focus")) {
-		rc.focus_follow_mouse = get_bool(content);
-	} else if (!strcasecmp(nodename, "RaiseOnFocus.focus")) {
-		rc.focus_follow_mouse = true;
-		rc.raise_on_focus = get_bool(content);
-	}
+static void
+core_decoration(const char *content, void *data)
+{
+	current_rc->xdg_shell_server_side_deco = !!strcmp(content, "client");
 }
 
 static void
-process_node(xmlNode *node)
+core_idle_timeout(const char *content, void *data)
 {
-	char *content;
-	static char buffer[256];
-	char *name;
+	current_rc->idle_timeout = atoi(content);
+}
 
-	content = (char *)node->content;
-	if (xmlIsBlankNode(node)) {
-		return;
-	}
-	name = nodename(node, buffer, sizeof(buffer));
-	entry(node, name, content);
+static void
+theme_name(const char *content, void *data)
+{
+	current_rc->theme_name = strdup(content);
 }
 
-static void xml_tree_walk(xmlNode *node);
+static void
+theme_corner_radius(const char *content, void *data)
+{
+	current_rc->corner_radius = atoi(content);
+}
 
 static void
-traverse(xmlNode *n)
+focus_follow_mouse(const char *content, void *data)
 {
-	process_node(n);
-	is_attribute = true;
-	for (xmlAttr *attr = n->properties; attr; attr = attr->next) {
-		xml_tree_walk(attr->children);
-	}
-	is_attribute = false;
-	xml_tree_walk(n->children);
+	current_rc->focus_follow_mouse = get_bool(content);
 }
 
 static void
-xml_tree_walk(xmlNode *node)
+focus_raise_on_focus(const char *content, void *data)
 {
-	for (xmlNode *n = node; n && n->name; n = n->next) {
-		if (!strcasecmp((char *)n->name, "comment")) {
-			continue;
-		}
-		if (!strcasecmp((char *)n->name, "keybind")) {
-			in_keybind = true;
-			traverse(n);
-			in_keybind = false;
-			continue;
-		}
-		traverse(n);
-	}
+	current_rc->focus_follow_mouse = true;
+	current_rc->raise_on_focus = get_bool(content);
+}
+
+static const struct xml_path paths[] = {
+	{ "key.keybind.keyboard", keybind_key },
+	{ "name.action.keybind.keyboard", keybind_action },
+	{ "command.action.keybind.keyboard", keybind_command },
+	{ "direction.action.keybind.keyboard", keybind_command },
+	{ "menu.action.keybind.keyboard", keybind_command },
+	{ "decoration.core", core_decoration },
+	{ "idletimeout.core", core_idle_timeout },
+	{ "name.theme", theme_name },
+	{ "cornerradius.theme", theme_corner_radius },
+	{ "place.font.theme", font_set_place },
+	{ "name.font.theme", font_name },
+	{ "size.font.theme", font_size },
+	{ "followmouse.focus", focus_follow_mouse },
+	{ "raiseonfocus.focus", focus_raise_on_focus },
+};
+
+static bool
+parse_xml(struct rcxml *config, const char *buf, size_t len,
+		const char *url)
+{
+	current_rc = config;
+	current_keybind = NULL;
+	font_place = FONT_PLACE_UNKNOWN;
+	struct xml_parser parser = {
+		.paths = paths,
+		.nr_paths = sizeof(paths) / sizeof(paths[0]),
+		.debug = getenv("LABWC_DEBUG_CONFIG_NODENAMES"),
+	};
+	bool ok = xml_read(&parser, buf, len, url);
+	current_rc = NULL;
+	current_keybind = NULL;
+	return ok;
 }
 
 /* Exposed in header file to allow unit tests to parse buffers */
 void
 rcxml_parse_xml(struct buf *b)
 {
-	xmlDoc *d = xmlParseMemory(b->buf, b->len);
-	if (!d) {
-		wlr_log(WLR_ERROR, "xmlParseMemory()");
-		exit(EXIT_FAILURE);
-	}
-	xml_tree_walk(xmlDocGetRootElement(d));
-	xmlFreeDoc(d);
-	xmlCleanupParser();
+	parse_xml(&rc, b->buf, b->len, NULL);
 }
 
 static void
-rcxml_init()
+rcxml_init(struct rcxml *config)
 {
 	static bool has_run;
 
-	if (has_run) {
-		return;
+	if (!has_run) {
+		LIBXML_TEST_VERSION
+		has_run = true;
 	}
-	has_run = true;
-	LIBXML_TEST_VERSION
-	wl_list_init(&rc.keybinds);
-	rc.xdg_shell_server_side_deco = true;
-	rc.corner_radius = 8;
-	rc.font_size_activewindow = 10;
+	memset(config, 0, sizeof(*config));
+	wl_list_init(&config->keybinds);
+	config->xdg_shell_server_side_deco = true;
+	config->corner_radius = 8;
+	config->font_size_activewindow = 10;
 }
 
 static void
-bind(const char *binding, const char *action, const char *command)
+bind(struct rcxml *config, const char *binding, const char *action,
+		const char *command)
 {
 	if (!binding || !action) {
 		return;
 	}
-	struct keybind *k = keybind_create(binding);
+	struct keybind *k = keybind_create(&config->keybinds, binding);
 	if (!k) {
 		return;
 	}
@@ -269,17 +228,17 @@ bind(const char *binding, const char *action, const char *command)
 }
 
 static void
-post_processing(void)
+post_processing(struct rcxml *config)
 {
-	if (!wl_list_length(&rc.keybinds)) {
+	if (!wl_list_length(&config->keybinds)) {
 		wlr_log(WLR_INFO, "load default key bindings");
-		bind("A-Escape", "Exit", NULL);
-		bind("A-Tab", "NextWindow", NULL);
-		bind("A-F3", "Execute", "bemenu-run");
+		bind(config, "A-Escape", "Exit", NULL);
+		bind(config, "A-Tab", "NextWindow", NULL);
+		bind(config, "A-F3", "Execute", "bemenu-run");
 	}
 
-	if (!rc.font_name_activewindow) {
-		rc.font_name_activewindow = strdup("sans");
+	if (!config->font_name_activewindow) {
+		config->font_name_activewindow = strdup("sans");
 	}
 }
 
@@ -302,19 +261,16 @@ find_config_file(char *buffer, size_t len, const char *filename)
 	rcxml_path(buffer, len);
 }
 
-void
-rcxml_read(const char *filename)
+bool
+rcxml_load(struct rcxml *config, const char *filename)
 {
-	FILE *stream;
-	char *line = NULL;
-	size_t len = 0;
-	struct buf b;
-	static char rcxml[4096] = { 0 };
+	bool ok = true;
+	uint64_t start = timing_begin();
 
-	rcxml_init();
+	rcxml_init(config);
 
 	/*
-	 * rcxml_read() can be called multiple times, but we only set rcxml[]
+	 * rcxml_load() can be called multiple times, but we only set rcxml[]
 	 * the first time. The specified 'filename' is only respected the first
 	 * time.
 	 */
@@ -327,35 +283,45 @@ rcxml_read(const char *filename)
 	}
 
 	/* Reading file into buffer before parsing - better for unit tests */
-	stream = fopen(rcxml, "r");
-	if (!stream) {
+	char *buf = grab_file(rcxml);
+	if (!buf) {
 		wlr_log(WLR_ERROR, "cannot read (%s)", rcxml);
 		goto no_config;
 	}
 	wlr_log(WLR_INFO, "read config file %s", rcxml);
-	buf_init(&b);
-	while (getline(&line, &len, stream) != -1) {
-		char *p = strrchr(line, '\n');
-		if (p)
-			*p = '\0';
-		buf_add(&b, line);
-	}
-	free(line);
-	fclose(stream);
-	rcxml_parse_xml(&b);
-	free(b.buf);
+	ok = parse_xml(config, buf, strlen(buf), rcxml);
+	free(buf);
 no_config:
-	post_processing();
+	post_processing(config);
+	timing_end("rcxml_read", start);
+	return ok;
+}
+
+uint64_t
+rcxml_hash(void)
+{
+	if (rcxml[0] == '\0') {
+		return HASH_INIT;
+	}
+	return hash_file(HASH_INIT, rcxml);
 }
 
 void
-rcxml_finish(void)
+rcxml_read(const char *filename)
 {
-	zfree(rc.font_name_activewindow);
-	zfree(rc.theme_name);
+	if (!rcxml_load(&rc, filename)) {
+		exit(EXIT_FAILURE);
+	}
+}
+
+void
+rcxml_free(struct rcxml *config)
+{
+	zfree(config->font_name_activewindow);
+	zfree(config->theme_name);
 
 	struct keybind *k, *k_tmp;
-	wl_list_for_each_safe (k, k_tmp, &rc.keybinds, link) {
+	wl_list_for_each_safe (k, k_tmp, &config->keybinds, link) {
 		wl_list_remove(&k->link);
 		zfree(k->command);
 		zfree(k->action);
@@ -363,3 +329,23 @@ rcxml_finish(void)
 		zfree(k);
 	}
 }
+
+void
+rcxml_replace(struct rcxml *config)
+{
+	rcxml_free(&rc);
+	rc = *config;
+
+	/* the list head has moved, so re-link the keybinds */
+	wl_list_init(&rc.keybinds);
+	wl_list_insert_list(&rc.keybinds, &config->keybinds);
+	wl_list_init(&config->keybinds);
+	config->font_name_activewindow = NULL;
+	config->theme_name = NULL;
+}
+
+void
+rcxml_finish(void)
+{
+	rcxml_free(&rc);
+}
@@ -1,10 +1,12 @@
 #include <assert.h>
 #include <linux/input-event-codes.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 #include "labwc.h"
 #include "menu/menu.h"
 #include "ssd.h"
+#include "trace.h"
 
 static void
 request_cursor_notify(struct wl_listener *listener, void *data)
@@ -49,7 +51,7 @@ process_cursor_move(struct server *server, uint32_t time)
 	struct view *view = server->grabbed_view;
 
 	/* Move the grabbed view to the new position. */
-	view->impl->move(view, server->grab_box.x + dx, server->grab_box.y + dy);
+	view_move(view, server->grab_box.x + dx, server->grab_box.y + dy);
 }
 
 #define MIN_VIEW_WIDTH (100)
@@ -94,7 +96,28 @@ set_cursor(struct server *server, const char *cursor_name)
 		server->seat.xcursor_manager, cursor_name, server->seat.cursor);
 }
 
+/* damage the titlebar buttons that the cursor leaves and enters */
 static void
+update_button_hover(struct server *server, struct view *view, int view_area)
+{
+	struct wlr_box box = { 0 };
+	if (view && ssd_is_button(view_area)) {
+		box = ssd_box(view, view_area);
+	}
+	struct wlr_box *hover = &server->ssd_hover_box;
+	if (!memcmp(&box, hover, sizeof(box))) {
+		return;
+	}
+	if (hover->width) {
+		damage_box(server, hover);
+	}
+	if (box.width) {
+		damage_box(server, &box);
+	}
+	*hover = box;
+}
+
+void
 process_cursor_motion(struct server *server, uint32_t time)
 {
 	static bool cursor_name_set_by_server;
@@ -107,9 +130,9 @@ process_cursor_motion(struct server *server, uint32_t time)
 		process_cursor_resize(server, time);
 		return;
 	} else if (server->input_mode == LAB_INPUT_STATE_MENU) {
+		/* damages just the items whose selection changed */
 		menu_set_selected(server->rootmenu,
 			server->seat.cursor->x, server->seat.cursor->y);
-		damage_all_outputs(server);
 		return;
 	}
 
@@ -148,7 +171,7 @@ process_cursor_motion(struct server *server, uint32_t time)
 	}
 
 	/* Required for iconify/maximize/close button mouse-over deco */
-	damage_all_outputs(server);
+	update_button_hover(server, view, view_area);
 
 	if (surface) {
 		bool focus_changed =
@@ -195,6 +218,9 @@ cursor_motion(struct wl_listener *listener, void *data)
 	 */
 	wlr_cursor_move(seat->cursor, event->device, event->delta_x,
 		event->delta_y);
+	trace_input(TRACE_CURSOR_MOTION, wl_fixed_from_double(seat->cursor->x),
+		wl_fixed_from_double(seat->cursor->y), 0);
+	idle_notify_activity(seat);
 	process_cursor_motion(seat->server, event->time_msec);
 }
 
@@ -213,6 +239,9 @@ cursor_motion_absolute(struct wl_listener *listener, void *data)
 		listener, seat, cursor_motion_absolute);
 	struct wlr_event_pointer_motion_absolute *event = data;
 	wlr_cursor_warp_absolute(seat->cursor, event->device, event->x, event->y);
+	trace_input(TRACE_CURSOR_MOTION, wl_fixed_from_double(seat->cursor->x),
+		wl_fixed_from_double(seat->cursor->y), 0);
+	idle_notify_activity(seat);
 	process_cursor_motion(seat->server, event->time_msec);
 }
 
@@ -260,6 +289,8 @@ cursor_button(struct wl_listener *listener, void *data)
 	struct seat *seat = wl_container_of(listener, seat, cursor_button);
 	struct server *server = seat->server;
 	struct wlr_event_pointer_button *event = data;
+	trace_input(TRACE_CURSOR_BUTTON, event->button, event->state, 0);
+	idle_notify_activity(seat);
 
 	double sx, sy;
 	struct wlr_surface *surface;
@@ -294,15 +325,20 @@ cursor_button(struct wl_listener *listener, void *data)
 	}
 
 	if (server->input_mode == LAB_INPUT_STATE_MENU) {
-		menu_action_selected(server, server->rootmenu);
+		if (menu_action_selected(server, server->rootmenu)) {
+			/* the item opens a submenu */
+			return;
+		}
 		server->input_mode = LAB_INPUT_STATE_PASSTHROUGH;
 		return;
 	}
 
 	/* Handle _press_ on a layer surface */
 	if (!view && surface) {
-		/* ...if we've ended up here it must be a layer surface */
-		assert(wlr_surface_is_layer_surface(surface));
+		/* ...if we've ended up here it must be a layer surface or popup */
+		if (!wlr_surface_is_layer_surface(surface)) {
+			return;
+		}
 		struct wlr_layer_surface_v1 *layer =
 			wlr_layer_surface_v1_from_wlr_surface(surface);
 		if (layer->current.keyboard_interactive) {
@@ -357,6 +393,9 @@ cursor_axis(struct wl_listener *listener, void *data)
 	 */
 	struct seat *seat = wl_container_of(listener, seat, cursor_axis);
 	struct wlr_event_pointer_axis *event = data;
+	trace_input(TRACE_CURSOR_AXIS, event->orientation | event->source << 16,
+		wl_fixed_from_double(event->delta), event->delta_discrete);
+	idle_notify_activity(seat);
 
 	/* Notify the client with pointer focus of the axis event. */
 	wlr_seat_pointer_notify_axis(seat->seat, event->time_msec,
@@ -375,6 +414,7 @@ cursor_frame(struct wl_listener *listener, void *data)
 	 * between.
 	 */
 	struct seat *seat = wl_container_of(listener, seat, cursor_frame);
+	trace_input(TRACE_CURSOR_FRAME, 0, 0, 0);
 	/* Notify the client with pointer focus of the frame event. */
 	wlr_seat_pointer_notify_frame(seat->seat);
 }
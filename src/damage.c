@@ -11,11 +11,36 @@ damage_all_outputs(struct server *server)
 	}
 }
 
+void
+damage_box(struct server *server, struct wlr_box *box)
+{
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (!output->wlr_output->enabled || !output->damage) {
+			continue;
+		}
+		double ox = 0, oy = 0;
+		wlr_output_layout_output_coords(server->output_layout,
+			output->wlr_output, &ox, &oy);
+		struct wlr_box damage = {
+			.x = box->x + ox,
+			.y = box->y + oy,
+			.width = box->width,
+			.height = box->height,
+		};
+		scale_box(&damage, output->wlr_output->scale);
+		wlr_output_damage_add_box(output->damage, &damage);
+	}
+}
+
 void
 damage_view_part(struct view *view)
 {
 	struct output *output;
 	wl_list_for_each (output, &view->server->outputs, link) {
+		if (!view_on_output(view, output)) {
+			continue;
+		}
 		output_damage_surface(output, view->surface, view->x, view->y,
 			false);
 	}
@@ -26,6 +51,9 @@ damage_view_whole(struct view *view)
 {
 	struct output *output;
 	wl_list_for_each (output, &view->server->outputs, link) {
+		if (!view_on_output(view, output)) {
+			continue;
+		}
 		output_damage_surface(output, view->surface, view->x, view->y,
 			true);
 	}
@@ -1,14 +1,43 @@
 #include "config.h"
 #include <assert.h>
+#include "common/timing.h"
 #include "labwc.h"
 #include "layers.h"
 #include "ssd.h"
 
+void
+desktop_restack(struct server *server)
+{
+	int nr_views = wl_list_length(&server->views);
+	if (nr_views > server->mapped_views_alloc) {
+		struct view **views = realloc(server->mapped_views,
+			nr_views * 2 * sizeof(struct view *));
+		if (views) {
+			server->mapped_views = views;
+			server->mapped_views_alloc = nr_views * 2;
+		} else {
+			wlr_log(WLR_ERROR, "cannot grow view stack");
+		}
+	}
+	server->nr_mapped_views = 0;
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		/* on allocation failure, the bottom-most views are left out */
+		if (server->nr_mapped_views == server->mapped_views_alloc) {
+			break;
+		}
+		if (view->mapped) {
+			server->mapped_views[server->nr_mapped_views++] = view;
+		}
+	}
+}
+
 static void
 move_to_front(struct view *view)
 {
 	wl_list_remove(&view->link);
 	wl_list_insert(&view->server->views, &view->link);
+	desktop_restack(view->server);
 }
 
 #if HAVE_XWAYLAND
@@ -177,31 +206,10 @@ desktop_cycle_view(struct server *server, struct view *current)
 	return view;
 }
 
-static bool
-has_mapped_view(struct wl_list *wl_list)
-{
-	struct view *view;
-	wl_list_for_each (view, wl_list, link) {
-		if (view->mapped) {
-			return true;
-		}
-	}
-	return false;
-}
-
 struct view *
 topmost_mapped_view(struct server *server)
 {
-	if (!has_mapped_view(&server->views)) {
-		return NULL;
-	}
-
-	/* start from tail of server->views */
-	struct view *view = wl_container_of(server->views.prev, view, link);
-	do {
-		view = wl_container_of(view->link.next, view, link);
-	} while (&view->link == &server->views || !view->mapped);
-	return view;
+	return server->nr_mapped_views ? server->mapped_views[0] : NULL;
 }
 
 void
@@ -268,8 +276,32 @@ wlr_surface *layer_surface_at(struct wl_list *layer, double lx, double ly,
 	return NULL;
 }
 
-struct view *
-desktop_view_at(struct server *server, double lx, double ly,
+/* popups of bottom and background layers are rendered above views */
+static struct wlr_surface *
+layer_popup_at(struct wl_list *layer, double lx, double ly,
+		double *sx, double *sy)
+{
+	struct lab_layer_surface *surface;
+	wl_list_for_each_reverse(surface, layer, link) {
+		struct wlr_xdg_popup *popup;
+		wl_list_for_each(popup, &surface->layer_surface->popups, link) {
+			double popup_sx = surface->geo.x + popup->geometry.x
+				- popup->base->geometry.x;
+			double popup_sy = surface->geo.y + popup->geometry.y
+				- popup->base->geometry.y;
+			struct wlr_surface *wlr_surface;
+			wlr_surface = wlr_xdg_surface_surface_at(popup->base,
+				lx - popup_sx, ly - popup_sy, sx, sy);
+			if (wlr_surface) {
+				return wlr_surface;
+			}
+		}
+	}
+	return NULL;
+}
+
+static struct view *
+view_at(struct server *server, double lx, double ly,
 		struct wlr_surface **surface, double *sx, double *sy,
 		int *view_area)
 {
@@ -288,12 +320,17 @@ desktop_view_at(struct server *server, double lx, double ly,
 					 lx, ly, sx, sy))) {
 		return NULL;
 	}
+	if ((*surface = layer_popup_at(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM],
+				       lx, ly, sx, sy))) {
+		return NULL;
+	}
+	if ((*surface = layer_popup_at(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND],
+				       lx, ly, sx, sy))) {
+		return NULL;
+	}
 
-	struct view *view;
-	wl_list_for_each (view, &server->views, link) {
-		if (!view->mapped) {
-			continue;
-		}
+	for (int i = 0; i < server->nr_mapped_views; i++) {
+		struct view *view = server->mapped_views[i];
 		if (_view_at(view, lx, ly, surface, sx, sy)) {
 			return view;
 		}
@@ -316,3 +353,14 @@ desktop_view_at(struct server *server, double lx, double ly,
 	}
 	return NULL;
 }
+
+struct view *
+desktop_view_at(struct server *server, double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy,
+		int *view_area)
+{
+	uint64_t start = timing_begin();
+	struct view *view = view_at(server, lx, ly, surface, sx, sy, view_area);
+	timing_end("desktop_view_at", start);
+	return view;
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <wlr/types/wlr_idle.h>
+#include <wlr/types/wlr_idle_inhibit_v1.h>
+#include "labwc.h"
+
+struct idle_inhibitor {
+	struct server *server;
+	struct wlr_idle_inhibitor_v1 *wlr_inhibitor;
+	struct wl_list link; /* server::idle_inhibitors */
+	struct wl_listener destroy;
+};
+
+/*
+ * An inhibitor only counts when its surface can be seen, so that a
+ * minimized video player does not keep the screens on.
+ */
+static bool
+inhibitor_is_active(struct server *server, struct wlr_surface *surface)
+{
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		if (view->surface == surface) {
+			return view->mapped;
+		}
+	}
+	return wlr_surface_has_buffer(surface);
+}
+
+static bool
+idle_is_inhibited(struct server *server)
+{
+	struct idle_inhibitor *inhibitor;
+	wl_list_for_each (inhibitor, &server->idle_inhibitors, link) {
+		if (inhibitor_is_active(server,
+				inhibitor->wlr_inhibitor->surface)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+idle_update_inhibit(struct server *server)
+{
+	wlr_idle_set_enabled(server->idle, server->seat.seat,
+		!idle_is_inhibited(server));
+}
+
+static void
+outputs_power_off(struct server *server)
+{
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (!output->wlr_output->enabled) {
+			continue;
+		}
+		wlr_output_enable(output->wlr_output, false);
+		if (!wlr_output_commit(output->wlr_output)) {
+			wlr_log(WLR_ERROR, "cannot power off output %s",
+				output->wlr_output->name);
+			continue;
+		}
+		output->powered_off = true;
+	}
+	server->outputs_powered_off = true;
+}
+
+static void
+outputs_power_on(struct server *server)
+{
+	/* outputs which fail to power on are tried again on the next input */
+	bool all_on = true;
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (!output->powered_off) {
+			continue;
+		}
+		wlr_output_enable(output->wlr_output, true);
+		if (!wlr_output_commit(output->wlr_output)) {
+			wlr_log(WLR_ERROR, "cannot power on output %s",
+				output->wlr_output->name);
+			all_on = false;
+			continue;
+		}
+		output->powered_off = false;
+		wlr_output_damage_add_whole(output->damage);
+	}
+	server->outputs_powered_off = !all_on;
+}
+
+static long
+ms_since(struct timespec *then)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - then->tv_sec) * 1000 +
+		(now.tv_nsec - then->tv_nsec) / 1000000;
+}
+
+static void
+arm_idle_timer(struct server *server, long ms)
+{
+	/* a timeout of zero disarms the timer */
+	wl_event_source_timer_update(server->idle_timer, ms);
+	server->idle_timer_armed = ms > 0;
+}
+
+/*
+ * The timer is not re-armed on every input event. Instead, when it fires
+ * it waits out whatever is left of the timeout since the last activity.
+ */
+static int
+handle_idle_timer(void *data)
+{
+	struct server *server = data;
+	server->idle_timer_armed = false;
+	if (rc.idle_timeout <= 0 || server->outputs_powered_off) {
+		return 0;
+	}
+	long remaining = rc.idle_timeout * 1000L -
+		ms_since(&server->idle_last_activity);
+	if (remaining > 0) {
+		arm_idle_timer(server, remaining);
+		return 0;
+	}
+	if (idle_is_inhibited(server)) {
+		arm_idle_timer(server, rc.idle_timeout * 1000L);
+		return 0;
+	}
+	wlr_log(WLR_INFO, "idle for %ds - power off outputs", rc.idle_timeout);
+	outputs_power_off(server);
+	return 0;
+}
+
+void
+idle_notify_activity(struct seat *seat)
+{
+	struct server *server = seat->server;
+	wlr_idle_notify_activity(server->idle, seat->seat);
+	clock_gettime(CLOCK_MONOTONIC, &server->idle_last_activity);
+	if (server->outputs_powered_off) {
+		outputs_power_on(server);
+	}
+	if (!server->idle_timer_armed && rc.idle_timeout > 0) {
+		arm_idle_timer(server, rc.idle_timeout * 1000L);
+	}
+}
+
+void
+idle_reset_timer(struct server *server)
+{
+	clock_gettime(CLOCK_MONOTONIC, &server->idle_last_activity);
+	arm_idle_timer(server, rc.idle_timeout > 0 ?
+		rc.idle_timeout * 1000L : 0);
+}
+
+static void
+handle_inhibitor_destroy(struct wl_listener *listener, void *data)
+{
+	struct idle_inhibitor *inhibitor =
+		wl_container_of(listener, inhibitor, destroy);
+	struct server *server = inhibitor->server;
+	wl_list_remove(&inhibitor->link);
+	wl_list_remove(&inhibitor->destroy.link);
+	free(inhibitor);
+	idle_update_inhibit(server);
+}
+
+static void
+handle_new_inhibitor(struct wl_listener *listener, void *data)
+{
+	struct server *server =
+		wl_container_of(listener, server, new_idle_inhibitor);
+	struct wlr_idle_inhibitor_v1 *wlr_inhibitor = data;
+
+	struct idle_inhibitor *inhibitor = calloc(1, sizeof(*inhibitor));
+	if (!inhibitor) {
+		return;
+	}
+	inhibitor->server = server;
+	inhibitor->wlr_inhibitor = wlr_inhibitor;
+	inhibitor->destroy.notify = handle_inhibitor_destroy;
+	wl_signal_add(&wlr_inhibitor->events.destroy, &inhibitor->destroy);
+	wl_list_insert(&server->idle_inhibitors, &inhibitor->link);
+	idle_update_inhibit(server);
+}
+
+void
+idle_init(struct server *server)
+{
+	server->idle = wlr_idle_create(server->wl_display);
+	server->idle_inhibit_manager =
+		wlr_idle_inhibit_v1_create(server->wl_display);
+	if (!server->idle || !server->idle_inhibit_manager) {
+		wlr_log(WLR_ERROR, "unable to create idle manager");
+		exit(EXIT_FAILURE);
+	}
+	wl_list_init(&server->idle_inhibitors);
+	server->new_idle_inhibitor.notify = handle_new_inhibitor;
+	wl_signal_add(&server->idle_inhibit_manager->events.new_inhibitor,
+		&server->new_idle_inhibitor);
+
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(server->wl_display);
+	server->idle_timer = wl_event_loop_add_timer(event_loop,
+		handle_idle_timer, server);
+	idle_reset_timer(server);
+}
+
+void
+idle_finish(struct server *server)
+{
+	if (server->idle_timer) {
+		wl_event_source_remove(server->idle_timer);
+		server->idle_timer = NULL;
+	}
+}
@@ -1,6 +1,8 @@
 #include <wlr/backend/multi.h>
 #include <wlr/backend/session.h>
+#include "common/timing.h"
 #include "labwc.h"
+#include "trace.h"
 
 static void
 change_vt(struct server *server, unsigned int vt)
@@ -25,20 +27,14 @@ keyboard_modifiers_notify(struct wl_listener *listener, void *data)
 static bool
 handle_keybinding(struct server *server, uint32_t modifiers, xkb_keysym_t sym)
 {
-	struct keybind *keybind;
-	wl_list_for_each_reverse (keybind, &rc.keybinds, link) {
-		if (modifiers ^ keybind->modifiers) {
-			continue;
-		}
-		for (size_t i = 0; i < keybind->keysyms_len; i++) {
-			if (sym == keybind->keysyms[i]) {
-				action(server, keybind->action,
-				       keybind->command);
-				return true;
-			}
-		}
+	uint64_t start = timing_begin();
+	struct keybind *keybind = keybind_find(&rc.keybinds, modifiers, sym);
+	timing_end("handle_keybinding", start);
+	if (!keybind) {
+		return false;
 	}
-	return false;
+	action(server, keybind->action, keybind->command);
+	return true;
 }
 
 static void
@@ -49,6 +45,8 @@ keyboard_key_notify(struct wl_listener *listener, void *data)
 	struct server *server = seat->server;
 	struct wlr_event_keyboard_key *event = data;
 	struct wlr_seat *wlr_seat = server->seat.seat;
+	trace_input(TRACE_KEY, event->keycode, event->state, 0);
+	idle_notify_activity(seat);
 	struct wlr_input_device *device = seat->keyboard_group->input_device;
 
 	/* Translate libinput keycode -> xkbcommon */
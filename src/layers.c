@@ -13,6 +13,7 @@
 #include <wayland-server.h>
 #include <wlr/types/wlr_layer_shell_v1.h>
 #include <wlr/util/log.h>
+#include "common/timing.h"
 #include "layers.h"
 #include "labwc.h"
 
@@ -160,7 +161,14 @@ arrange_layer(struct wlr_output *output, struct wl_list *list,
 			state->exclusive_zone, state->margin.top,
 			state->margin.right, state->margin.bottom,
 			state->margin.left);
+		if (surface->configured && box.width == surface->configured_width
+				&& box.height == surface->configured_height) {
+			continue;
+		}
 		wlr_layer_surface_v1_configure(layer, box.width, box.height);
+		surface->configured = true;
+		surface->configured_width = box.width;
+		surface->configured_height = box.height;
 	}
 }
 
@@ -168,6 +176,7 @@ void
 arrange_layers(struct output *output)
 {
 	assert(output);
+	uint64_t start = timing_begin();
 
 	struct wlr_box usable_area = { 0 };
 	wlr_output_effective_resolution(output->wlr_output,
@@ -186,10 +195,10 @@ arrange_layers(struct output *output)
 	arrange_layer(output->wlr_output,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND],
 			&usable_area, true);
+	bool usable_area_changed = memcmp(&output->usable_area, &usable_area,
+		sizeof(struct wlr_box));
 	memcpy(&output->usable_area, &usable_area, sizeof(struct wlr_box));
 
-	/* TODO: re-arrange all views taking into account updated usable_area */
-
 	/* Non-exclusive surfaces */
 	arrange_layer(output->wlr_output,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY],
@@ -230,6 +239,12 @@ arrange_layers(struct output *output)
 			!seat->focused_layer->current.keyboard_interactive) {
 		seat_set_focus_layer(seat, NULL);
 	}
+
+	/* after the layers, so that views see the final usable area */
+	if (usable_area_changed) {
+		view_arrange_maximized(output);
+	}
+	timing_end("arrange_layers", start);
 }
 
 static void
@@ -242,16 +257,211 @@ output_destroy_notify(struct wl_listener *listener, void *data)
 	wlr_layer_surface_v1_destroy(layer->layer_surface);
 }
 
+/* does the commit change how layers are arranged? */
+static bool
+layout_changed(struct lab_layer_surface *layer)
+{
+	struct wlr_layer_surface_v1 *layer_surface = layer->layer_surface;
+	struct wlr_layer_surface_v1_state *old = &layer->arranged;
+	struct wlr_layer_surface_v1_state *new = &layer_surface->current;
+	return layer->arranged_mapped != layer_surface->mapped
+		|| old->layer != new->layer
+		|| old->anchor != new->anchor
+		|| old->exclusive_zone != new->exclusive_zone
+		|| old->margin.top != new->margin.top
+		|| old->margin.right != new->margin.right
+		|| old->margin.bottom != new->margin.bottom
+		|| old->margin.left != new->margin.left
+		|| old->desired_width != new->desired_width
+		|| old->desired_height != new->desired_height
+		|| old->keyboard_interactive != new->keyboard_interactive;
+}
+
+static void
+damage_layer_surface(struct output *output, struct lab_layer_surface *layer)
+{
+	struct wlr_box *output_box = wlr_output_layout_get_box(
+		layer->server->output_layout, output->wlr_output);
+	if (!output_box) {
+		return;
+	}
+	output_damage_surface(output, layer->layer_surface->surface,
+		output_box->x + layer->geo.x, output_box->y + layer->geo.y,
+		false);
+}
+
 static void
 surface_commit_notify(struct wl_listener *listener, void *data)
 {
 	struct lab_layer_surface *layer =
 		wl_container_of(listener, layer, surface_commit);
-	struct wlr_output *wlr_output = layer->layer_surface->output;
-	arrange_layers(output_from_wlr_output(layer->server, wlr_output));
+	struct wlr_layer_surface_v1 *layer_surface = layer->layer_surface;
+	struct wlr_output *wlr_output = layer_surface->output;
+	stats_commit(&layer->stats, layer_surface->surface);
+	if (!wlr_output) {
+		return;
+	}
+	struct output *output = output_from_wlr_output(layer->server,
+		wlr_output);
+
+	/*
+	 * Panels with clocks or graphs commit often, but rarely change their
+	 * layout, so in that case only damage what they have drawn
+	 */
+	if (!layout_changed(layer)) {
+		damage_layer_surface(output, layer);
+		return;
+	}
+	if (layer->arranged.layer != layer_surface->current.layer) {
+		wl_list_remove(&layer->link);
+		wl_list_insert(&output->layers[layer_surface->current.layer],
+			&layer->link);
+	}
+	layer->arranged = layer_surface->current;
+	layer->arranged_mapped = layer_surface->mapped;
+	arrange_layers(output);
 	damage_all_outputs(layer->server);
 }
 
+/*
+ * Damage a popup at its position relative to the root layer surface. If it
+ * has moved, been resized or lost its buffer, the area it covered before is
+ * damaged too, so that nothing stale is left behind.
+ */
+static void
+damage_popup(struct lab_layer_popup *popup, bool whole)
+{
+	struct lab_layer_surface *layer = popup->layer;
+	struct wlr_output *wlr_output = layer->layer_surface->output;
+	if (!wlr_output) {
+		return;
+	}
+	struct output *output = output_from_wlr_output(layer->server,
+		wlr_output);
+	struct wlr_box *output_box = wlr_output_layout_get_box(
+		layer->server->output_layout, wlr_output);
+	if (!output || !output_box) {
+		return;
+	}
+	struct wlr_xdg_popup *wlr_popup = popup->wlr_popup;
+	struct wlr_surface *surface = wlr_popup->base->surface;
+	int sx, sy;
+	wlr_xdg_popup_get_toplevel_coords(wlr_popup,
+		wlr_popup->geometry.x - wlr_popup->base->geometry.x,
+		wlr_popup->geometry.y - wlr_popup->base->geometry.y, &sx, &sy);
+	struct wlr_box box = {
+		.x = output_box->x + layer->geo.x + sx,
+		.y = output_box->y + layer->geo.y + sy,
+		.width = surface->current.width,
+		.height = surface->current.height,
+	};
+	if (memcmp(&box, &popup->damaged, sizeof(box))) {
+		damage_box(layer->server, &popup->damaged);
+		popup->damaged = box;
+		whole = true;
+	}
+	output_damage_surface(output, surface, box.x, box.y, whole);
+}
+
+static void
+popup_handle_commit(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_popup *popup = wl_container_of(listener, popup, commit);
+	damage_popup(popup, false);
+}
+
+static void
+popup_handle_map(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_popup *popup = wl_container_of(listener, popup, map);
+	damage_popup(popup, true);
+}
+
+static void
+popup_handle_unmap(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_popup *popup = wl_container_of(listener, popup, unmap);
+	damage_popup(popup, true);
+	/* the surface may have no buffer left, so damage where it was too */
+	damage_box(popup->layer->server, &popup->damaged);
+	popup->damaged = (struct wlr_box){0};
+}
+
+static void
+popup_handle_destroy(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_popup *popup =
+		wl_container_of(listener, popup, destroy);
+	wl_list_remove(&popup->commit.link);
+	wl_list_remove(&popup->map.link);
+	wl_list_remove(&popup->unmap.link);
+	wl_list_remove(&popup->destroy.link);
+	wl_list_remove(&popup->new_popup.link);
+	free(popup);
+}
+
+static void popup_create(struct wlr_xdg_popup *wlr_popup,
+	struct lab_layer_surface *layer);
+
+static void
+popup_handle_new_popup(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_popup *popup =
+		wl_container_of(listener, popup, new_popup);
+	popup_create(data, popup->layer);
+}
+
+/* keep the popup on the output of its layer surface */
+static void
+popup_unconstrain(struct lab_layer_popup *popup)
+{
+	struct lab_layer_surface *layer = popup->layer;
+	struct wlr_output *wlr_output = layer->layer_surface->output;
+	if (!wlr_output) {
+		return;
+	}
+	struct wlr_box output_box = {
+		.x = -layer->geo.x,
+		.y = -layer->geo.y,
+	};
+	wlr_output_effective_resolution(wlr_output, &output_box.width,
+		&output_box.height);
+	wlr_xdg_popup_unconstrain_from_box(popup->wlr_popup, &output_box);
+}
+
+static void
+popup_create(struct wlr_xdg_popup *wlr_popup, struct lab_layer_surface *layer)
+{
+	struct lab_layer_popup *popup = calloc(1, sizeof(*popup));
+	if (!popup) {
+		return;
+	}
+	popup->wlr_popup = wlr_popup;
+	popup->layer = layer;
+
+	popup->commit.notify = popup_handle_commit;
+	wl_signal_add(&wlr_popup->base->surface->events.commit,
+		&popup->commit);
+	popup->map.notify = popup_handle_map;
+	wl_signal_add(&wlr_popup->base->events.map, &popup->map);
+	popup->unmap.notify = popup_handle_unmap;
+	wl_signal_add(&wlr_popup->base->events.unmap, &popup->unmap);
+	popup->destroy.notify = popup_handle_destroy;
+	wl_signal_add(&wlr_popup->base->events.destroy, &popup->destroy);
+	popup->new_popup.notify = popup_handle_new_popup;
+	wl_signal_add(&wlr_popup->base->events.new_popup, &popup->new_popup);
+
+	popup_unconstrain(popup);
+}
+
+static void
+new_popup_notify(struct wl_listener *listener, void *data)
+{
+	struct lab_layer_surface *layer =
+		wl_container_of(listener, layer, new_popup);
+	popup_create(data, layer);
+}
+
 static void
 unmap(struct lab_layer_surface *layer)
 {
@@ -259,6 +469,8 @@ unmap(struct lab_layer_surface *layer)
 	if (seat->focused_layer == layer->layer_surface) {
 		seat_set_focus_layer(seat, NULL);
 	}
+	/* the client has to wait for a new configure before mapping again */
+	layer->configured = false;
 	damage_all_outputs(layer->server);
 }
 
@@ -273,6 +485,8 @@ destroy_notify(struct wl_listener *listener, void *data)
 	wl_list_remove(&layer->link);
 	wl_list_remove(&layer->destroy.link);
 	wl_list_remove(&layer->map.link);
+	wl_list_remove(&layer->unmap.link);
+	wl_list_remove(&layer->new_popup.link);
 	wl_list_remove(&layer->surface_commit.link);
 	if (layer->layer_surface->output) {
 		wl_list_remove(&layer->output_destroy.link);
@@ -340,8 +554,12 @@ new_layer_surface_notify(struct wl_listener *listener, void *data)
 	surface->unmap.notify = unmap_notify;
 	wl_signal_add(&layer_surface->events.unmap, &surface->unmap);
 
+	surface->new_popup.notify = new_popup_notify;
+	wl_signal_add(&layer_surface->events.new_popup, &surface->new_popup);
+
 	wl_list_insert(&output->layers[layer_surface->client_pending.layer],
 		&surface->link);
+	surface->arranged.layer = layer_surface->client_pending.layer;
 	/*
 	 * Temporarily set the layer's current state to client_pending so that
 	 * it can easily be arranged.
@@ -1,15 +1,19 @@
+#include <libxml/parser.h>
 #include "common/font.h"
 #include "common/spawn.h"
+#include "common/timing.h"
 #include "config/session.h"
 #include "labwc.h"
 #include "theme.h"
+#include "trace.h"
 #include "xbm/xbm.h"
 #include "menu/menu.h"
 
 struct rcxml rc = { 0 };
 
 static const char labwc_usage[] =
-	"Usage: labwc [-h] [-s <command>] [-c <config-file>] [-d] [-V] [-v]\n";
+	"Usage: labwc [-h] [-s <command>] [-c <config-file>] [-d] [-V] [-v]\n"
+	"             [-r <trace-file>] [-p <trace-file>]\n";
 
 static void
 usage(void)
@@ -23,10 +27,12 @@ main(int argc, char *argv[])
 {
 	char *startup_cmd = NULL;
 	char *config_file = NULL;
+	char *record_file = NULL;
+	char *replay_file = NULL;
 	enum wlr_log_importance verbosity = WLR_ERROR;
 
 	int c;
-	while ((c = getopt(argc, argv, "c:dhs:vV")) != -1) {
+	while ((c = getopt(argc, argv, "c:dhp:r:s:vV")) != -1) {
 		switch (c) {
 		case 'c':
 			config_file = optarg;
@@ -34,6 +40,12 @@ main(int argc, char *argv[])
 		case 'd':
 			verbosity = WLR_DEBUG;
 			break;
+		case 'p':
+			replay_file = optarg;
+			break;
+		case 'r':
+			record_file = optarg;
+			break;
 		case 's':
 			startup_cmd = optarg;
 			break;
@@ -55,6 +67,12 @@ main(int argc, char *argv[])
 	wlr_log_init(verbosity, NULL);
 
 	session_environment_init();
+
+	/*
+	 * libxml2 is used from the reload thread and the event loop, so its
+	 * global state is set up once here and only freed on exit
+	 */
+	xmlInitParser();
 	rcxml_read(config_file);
 
 	if (!getenv("XDG_RUNTIME_DIR")) {
@@ -62,13 +80,18 @@ main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (record_file) {
+		trace_record_init(record_file);
+	}
+
 	struct server server = { 0 };
 	server_init(&server);
 	server_start(&server);
 
 	struct theme theme = { 0 };
-	theme_init(&theme, server.renderer, rc.theme_name);
+	theme_init(&theme, server.renderer);
 	server.theme = &theme;
+	output_update_scaled_textures(&server);
 
 	struct menu rootmenu = { 0 };
 	menu_init_rootmenu(&server, &rootmenu);
@@ -77,14 +100,20 @@ main(int argc, char *argv[])
 	if (startup_cmd) {
 		spawn_async_no_shell(startup_cmd);
 	}
+	if (replay_file) {
+		trace_replay(&server, replay_file);
+	}
 
 	wl_display_run(server.wl_display);
 
+	trace_finish();
 	server_finish(&server);
 
 	menu_finish(&rootmenu);
 	theme_finish(&theme);
 	rcxml_finish();
+	xmlCleanupParser();
 	font_finish();
+	timing_finish();
 	return 0;
 }
@@ -1,191 +1,563 @@
 #define _POSIX_C_SOURCE 200809L
-#include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <libxml/parser.h>
-#include <libxml/tree.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
+#include <unistd.h>
 #include <wlr/util/log.h>
-#include "common/buf.h"
 #include "common/dir.h"
 #include "common/font.h"
-#include "common/nodename.h"
-#include "common/string-helpers.h"
+#include "common/grab-file.h"
+#include "common/hash.h"
+#include "common/spawn.h"
+#include "common/xml.h"
 #include "common/zfree.h"
 #include "labwc.h"
 #include "menu/menu.h"
 #include "theme.h"
 
-/* state-machine variables for processing <item></item> */
-static bool in_item = false;
-static struct menuitem *current_item;
-
 #define MENUWIDTH (110)
 #define MENUHEIGHT (25)
 #define MENU_PADDING_WIDTH (7)
 
+/* menus nested deeper than this in menu.xml are ignored */
+#define MENU_MAX_DEPTH (16)
+
+/* output of pipe menus is re-used for this long before re-running them */
+#define PIPE_MENU_TTL_MS (30000)
+
+/* state for reading menu.xml or the output of a pipe menu */
+struct menu_parser {
+	struct menu *root;
+	/* menus being defined, innermost last, and the items opening them */
+	struct menu *menus[MENU_MAX_DEPTH];
+	struct menuitem *openers[MENU_MAX_DEPTH];
+	int depth;
+	/* item being defined */
+	struct menuitem *item;
+	/* pipe menu whose output is being read, if any */
+	struct menu *pipe;
+};
+
 static struct menuitem *
-menuitem_create(struct server *server, struct menu *menu, const char *text)
+menuitem_create(struct menu *menu, const char *text)
 {
 	struct menuitem *menuitem = calloc(1, sizeof(struct menuitem));
 	if (!menuitem) {
 		return NULL;
 	}
-	struct theme *theme = server->theme;
+	menuitem->label = text ? strdup(text) : NULL;
 	menuitem->box.width = MENUWIDTH;
 	menuitem->box.height = MENUHEIGHT;
+	wl_list_insert(&menu->menuitems, &menuitem->link);
+	return menuitem;
+}
 
-	/* TODO: use rc.font_menu_item */
-	font_texture_create(server, &menuitem->texture.active, MENUWIDTH,
-		text, rc.font_name_activewindow, theme->menu_items_active_text_color);
-	font_texture_create(server, &menuitem->texture.inactive, MENUWIDTH,
-		text, rc.font_name_activewindow, theme->menu_items_text_color);
-
-	/* center align vertically */
-	menuitem->texture.offset_y =
-		(menuitem->box.height - menuitem->texture.active->height) / 2;
+/* center align text vertically */
+static void
+menuitem_set_offset(struct server *server, struct menuitem *menuitem,
+		struct wlr_texture *texture)
+{
+	int width, height;
+	font_texture_size(server, texture, &width, &height);
+	menuitem->texture.offset_y = (menuitem->box.height - height) / 2;
 	menuitem->texture.offset_x = MENU_PADDING_WIDTH;
+}
 
-	wl_list_insert(&menu->menuitems, &menuitem->link);
-	return menuitem;
+/*
+ * Textures are created on first use rather than when the menu is read, so
+ * that startup and reload do not depend on the size of the menu
+ */
+static void
+menuitem_texture_create(struct server *server, struct menuitem *menuitem,
+		bool active)
+{
+	struct wlr_texture **texture = active ? &menuitem->texture.active
+		: &menuitem->texture.inactive;
+	if (*texture || !menuitem->label) {
+		return;
+	}
+	struct theme *theme = server->theme;
+	float *color = active ? theme->menu_items_active_text_color
+		: theme->menu_items_text_color;
+
+	/* TODO: use rc.font_menu_item */
+	font_texture_create(server, texture, MENUWIDTH, menuitem->label,
+		rc.font_name_activewindow, color);
+	if (*texture) {
+		menuitem_set_offset(server, menuitem, *texture);
+	}
 }
 
-static void fill_item(char *nodename, char *content, struct menu *menu)
+static void
+menuitem_texture_destroy(struct menuitem *menuitem)
 {
-	string_truncate_at_pattern(nodename, ".item.menu");
+	if (menuitem->texture.active) {
+		wlr_texture_destroy(menuitem->texture.active);
+		menuitem->texture.active = NULL;
+	}
+	if (menuitem->texture.inactive) {
+		wlr_texture_destroy(menuitem->texture.inactive);
+		menuitem->texture.inactive = NULL;
+	}
+}
+
+static void
+menuitem_free(struct menuitem *menuitem)
+{
+	menuitem_texture_destroy(menuitem);
+	zfree(menuitem->label);
+	zfree(menuitem->action);
+	zfree(menuitem->command);
+	wl_list_remove(&menuitem->link);
+	free(menuitem);
+}
 
-	if (getenv("LABWC_DEBUG_MENU_NODENAMES")) {
-		printf("%s: %s\n", nodename, content);
+static void
+menu_items_free(struct menu *menu)
+{
+	struct menuitem *menuitem, *next;
+	wl_list_for_each_safe(menuitem, next, &menu->menuitems, link) {
+		menuitem_free(menuitem);
 	}
+	zfree(menu->items);
+	menu->nr_items = 0;
+	menu->selected = NULL;
+}
 
-	/*
-	 * Handle the following:
-	 * <item label="">
-	 *   <action name="">
-	 *     <command></command>
-	 *   </action>
-	 * </item>
-	 */
-	if (!strcmp(nodename, "label")) {
-		current_item = menuitem_create(menu->server, menu, content);
+/* create a menu owned by @root */
+static struct menu *
+menu_create(struct menu *root, struct menu *pipe_parent)
+{
+	struct menu *menu = calloc(1, sizeof(struct menu));
+	if (!menu) {
+		return NULL;
 	}
-	assert(current_item);
-	if (!strcmp(nodename, "name.action")) {
-		current_item->action = strdup(content);
-	} else if (!strcmp(nodename, "command.action")) {
-		current_item->command = strdup(content);
+	menu->server = root->server;
+	menu->pipe_parent = pipe_parent;
+	menu->pipe.fd = -1;
+	wl_list_init(&menu->menuitems);
+	wl_list_insert(root->menus.prev, &menu->link);
+	return menu;
+}
+
+static void
+pipe_menu_stop(struct menu *menu)
+{
+	if (menu->pipe.source) {
+		wl_event_source_remove(menu->pipe.source);
+		menu->pipe.source = NULL;
 	}
+	if (menu->pipe.fd >= 0) {
+		close(menu->pipe.fd);
+		menu->pipe.fd = -1;
+	}
+	zfree(menu->pipe.buf);
+	menu->pipe.len = 0;
+	menu->pipe.alloc = 0;
 }
 
 static void
-entry(xmlNode *node, char *nodename, char *content, struct menu *menu)
+menu_free(struct menu *menu)
 {
-	static bool in_root_menu = false;
+	menu_items_free(menu);
+	pipe_menu_stop(menu);
+	zfree(menu->id);
+	zfree(menu->label);
+	zfree(menu->execute);
+	wl_list_remove(&menu->link);
+	free(menu);
+}
 
-	if (!nodename) {
-		return;
+static struct menu *
+parser_menu(struct menu_parser *parser)
+{
+	if (!parser->depth || parser->depth > MENU_MAX_DEPTH) {
+		return NULL;
 	}
-	string_truncate_at_pattern(nodename, ".openbox_menu");
-	if (!content) {
-		return;
+	return parser->menus[parser->depth - 1];
+}
+
+/*
+ * Handle the following:
+ * <menu id="" label="" execute="">
+ *   <item label="">
+ *     <action name="">
+ *       <command></command>
+ *     </action>
+ *   </item>
+ *   <menu id=""/>
+ * </menu>
+ * A <menu> inside another one is shown as a submenu. If it only has an id,
+ * it refers to a menu defined elsewhere. With execute="", its items are
+ * read from the output of the command when it is opened.
+ */
+static void
+menu_start(void *data)
+{
+	struct menu_parser *parser = data;
+	struct menu *parent = parser_menu(parser);
+	if (parser->depth < MENU_MAX_DEPTH) {
+		struct menu *menu = menu_create(parser->root, parser->pipe);
+		struct menuitem *opener = NULL;
+		if (menu && parent) {
+			opener = menuitem_create(parent, NULL);
+			if (opener) {
+				opener->submenu = menu;
+			}
+		}
+		parser->menus[parser->depth] = menu;
+		parser->openers[parser->depth] = opener;
 	}
-	if (!strcmp(nodename, "id.menu")) {
-		in_root_menu = !strcmp(content, "root-menu") ? true : false;
+	++parser->depth;
+	parser->item = NULL;
+}
+
+static void
+menu_end(void *data)
+{
+	struct menu_parser *parser = data;
+	--parser->depth;
+	parser->item = NULL;
+}
+
+static void
+menu_id(const char *content, void *data)
+{
+	struct menu *menu = parser_menu(data);
+	if (menu && !menu->id) {
+		menu->id = strdup(content);
 	}
+}
 
-	/* We only handle the root-menu for the time being */
-	if (!in_root_menu) {
+static void
+menu_label(const char *content, void *data)
+{
+	struct menu_parser *parser = data;
+	struct menu *menu = parser_menu(parser);
+	if (!menu || menu->label) {
 		return;
 	}
-	if (in_item) {
-		fill_item(nodename, content, menu);
+	menu->label = strdup(content);
+	struct menuitem *opener = parser->openers[parser->depth - 1];
+	if (opener && !opener->label) {
+		opener->label = strdup(content);
 	}
 }
 
 static void
-process_node(xmlNode *node, struct menu *menu)
+menu_execute(const char *content, void *data)
 {
-	char *content;
-	static char buffer[256];
-	char *name;
+	struct menu *menu = parser_menu(data);
+	if (menu && !menu->execute) {
+		menu->execute = strdup(content);
+	}
+}
 
-	content = (char *)node->content;
-	if (xmlIsBlankNode(node)) {
-		return;
+static void
+item_label(const char *content, void *data)
+{
+	struct menu_parser *parser = data;
+	struct menu *menu = parser_menu(parser);
+	if (menu) {
+		parser->item = menuitem_create(menu, content);
 	}
-	name = nodename(node, buffer, sizeof(buffer));
-	entry(node, name, content, menu);
 }
 
-static void xml_tree_walk(xmlNode *node, struct menu *menu);
+static void
+item_action(const char *content, void *data)
+{
+	struct menu_parser *parser = data;
+	if (parser->item && !parser->item->action) {
+		parser->item->action = strdup(content);
+	}
+}
 
 static void
-traverse(xmlNode *n, struct menu *menu)
+item_command(const char *content, void *data)
+{
+	struct menu_parser *parser = data;
+	if (parser->item && !parser->item->command) {
+		parser->item->command = strdup(content);
+	}
+}
+
+static const struct xml_path paths[] = {
+	{ "menu", NULL, menu_start, menu_end },
+	{ "id.menu", menu_id },
+	{ "label.menu", menu_label },
+	{ "execute.menu", menu_execute },
+	{ "label.item.menu", item_label },
+	{ "name.action.item.menu", item_action },
+	{ "command.action.item.menu", item_command },
+	{ "execute.action.item.menu", item_command },
+	/* pipe menu output has items at the top level */
+	{ "label.item", item_label },
+	{ "name.action.item", item_action },
+	{ "command.action.item", item_command },
+	{ "execute.action.item", item_command },
+};
+
+static bool
+parse_buf(struct menu_parser *parser, const char *buf, size_t len,
+		const char *url)
+{
+	struct xml_parser xml_parser = {
+		.paths = paths,
+		.nr_paths = sizeof(paths) / sizeof(paths[0]),
+		.scope = "menu",
+		.data = parser,
+		.debug = getenv("LABWC_DEBUG_MENU_NODENAMES"),
+	};
+	return xml_read(&xml_parser, buf, len, url);
+}
+
+static bool
+parse_xml(const char *filename, struct menu_parser *parser)
 {
-	process_node(n, menu);
-	for (xmlAttr *attr = n->properties; attr; attr = attr->next) {
-		xml_tree_walk(attr->children, menu);
+	static char menuxml[4096] = { 0 };
+
+	if (!strlen(config_dir())) {
+		return true;
+	}
+	snprintf(menuxml, sizeof(menuxml), "%s/%s", config_dir(), filename);
+
+	char *buf = grab_file(menuxml);
+	if (!buf) {
+		wlr_log(WLR_ERROR, "cannot read %s", menuxml);
+		return true;
+	}
+	wlr_log(WLR_INFO, "read menu file %s", menuxml);
+	bool ok = parse_buf(parser, buf, strlen(buf), menuxml);
+	free(buf);
+	return ok;
+}
+
+/* menus read by @parser, other than the root menu */
+static bool
+parser_owns(struct menu_parser *parser, struct menu *menu)
+{
+	return menu->pipe_parent == parser->pipe;
+}
+
+/* find the definition of menu @id read by @parser */
+static struct menu *
+parser_find_menu(struct menu_parser *parser, const char *id)
+{
+	if (!parser->pipe && !strcmp(id, "root-menu")) {
+		return parser->root;
+	}
+	struct menu *menu;
+	wl_list_for_each (menu, &parser->root->menus, link) {
+		if (parser_owns(parser, menu) && menu->id
+				&& !strcmp(menu->id, id)
+				&& (menu->execute
+				|| !wl_list_empty(&menu->menuitems))) {
+			return menu;
+		}
 	}
-	xml_tree_walk(n->children, menu);
+	return NULL;
 }
 
 static void
-xml_tree_walk(xmlNode *node, struct menu *menu)
+resolve_items(struct menu_parser *parser, struct menu *menu)
 {
-	for (xmlNode *n = node; n && n->name; n = n->next) {
-		if (!strcasecmp((char *)n->name, "comment")) {
+	struct menuitem *menuitem;
+	wl_list_for_each (menuitem, &menu->menuitems, link) {
+		struct menu *submenu = menuitem->submenu;
+		if (!submenu || !submenu->id || submenu->execute
+				|| !wl_list_empty(&submenu->menuitems)) {
 			continue;
 		}
-		if (!strcasecmp((char *)n->name, "item")) {
-			in_item = true;
-			traverse(n, menu);
-			in_item = false;
+		struct menu *definition = parser_find_menu(parser, submenu->id);
+		if (!definition) {
 			continue;
 		}
-		traverse(n, menu);
+		menuitem->submenu = definition;
+		if (!menuitem->label && definition->label) {
+			menuitem->label = strdup(definition->label);
+		}
 	}
 }
 
+/* point <menu id=""/> references at the menus they refer to */
 static void
-parse_xml(const char *filename, struct menu *menu)
+parser_resolve(struct menu_parser *parser)
 {
-	FILE *stream;
-	char *line = NULL;
-	size_t len = 0;
-	struct buf b;
-	static char menuxml[4096] = { 0 };
+	resolve_items(parser, parser->pipe ? parser->pipe : parser->root);
+	struct menu *menu;
+	wl_list_for_each (menu, &parser->root->menus, link) {
+		if (parser_owns(parser, menu)) {
+			resolve_items(parser, menu);
+		}
+	}
+}
 
-	if (!strlen(config_dir())) {
-		return;
+static bool
+menu_parse(struct menu *menu)
+{
+	struct menu_parser parser = { .root = menu };
+	bool ok = parse_xml("menu.xml", &parser);
+
+	/* <menu id="root-menu"> provides the items of the root menu */
+	struct menu *root_menu = NULL;
+	struct menu *m;
+	wl_list_for_each (m, &menu->menus, link) {
+		if (m->id && !strcmp(m->id, "root-menu")) {
+			root_menu = m;
+			break;
+		}
 	}
-	snprintf(menuxml, sizeof(menuxml), "%s/%s", config_dir(), filename);
+	if (root_menu) {
+		wl_list_insert_list(&menu->menuitems, &root_menu->menuitems);
+		wl_list_init(&root_menu->menuitems);
+	}
+	parser_resolve(&parser);
 
-	stream = fopen(menuxml, "r");
-	if (!stream) {
-		wlr_log(WLR_ERROR, "cannot read %s", menuxml);
+	/* Default menu if no menu.xml found */
+	if (wl_list_empty(&menu->menuitems)) {
+		struct menuitem *item = menuitem_create(menu, "Reconfigure");
+		item->action = strdup("Reconfigure");
+		item = menuitem_create(menu, "Exit");
+		item->action = strdup("Exit");
+	}
+	return ok;
+}
+
+static bool
+menu_is_shown(struct menu *menu)
+{
+	struct server *server = menu->server;
+	if (server->input_mode != LAB_INPUT_STATE_MENU) {
+		return false;
+	}
+	for (struct menu *m = server->rootmenu; m; m = m->open) {
+		if (m == menu) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint64_t
+now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* free menus defined by earlier output of pipe menu @menu */
+static void
+pipe_menu_free_children(struct menu *root, struct menu *menu)
+{
+	struct menu *m, *next;
+	bool found;
+	do {
+		found = false;
+		wl_list_for_each (m, &root->menus, link) {
+			if (!m->doomed && m->pipe_parent && (m->pipe_parent == menu
+					|| m->pipe_parent->doomed)) {
+				m->doomed = true;
+				found = true;
+			}
+		}
+	} while (found);
+	wl_list_for_each_safe (m, next, &root->menus, link) {
+		if (m->doomed) {
+			menu_free(m);
+		}
+	}
+}
+
+/* replace the items of pipe menu @menu with the output of its command */
+static void
+pipe_menu_fill(struct menu *menu)
+{
+	struct menu *root = menu->server->rootmenu;
+	menu->open = NULL;
+	menu_items_free(menu);
+	pipe_menu_free_children(root, menu);
+
+	struct menu_parser parser = {
+		.root = root,
+		.menus = { menu },
+		.depth = 1,
+		.pipe = menu,
+	};
+	if (menu->pipe.len && !parse_buf(&parser, menu->pipe.buf,
+			menu->pipe.len, menu->execute)) {
+		wlr_log(WLR_ERROR, "bad output from pipe menu (%s)",
+			menu->execute);
+	}
+	parser_resolve(&parser);
+	pipe_menu_stop(menu);
+	menu->pipe.updated_ms = now_ms();
+
+	menu_move(menu, menu->box.x, menu->box.y);
+	if (menu_is_shown(menu)) {
+		menu_texture_create(menu);
+		damage_all_outputs(menu->server);
+	}
+}
+
+static int
+handle_pipe_readable(int fd, uint32_t mask, void *data)
+{
+	struct menu *menu = data;
+	for (;;) {
+		if (menu->pipe.alloc - menu->pipe.len < 4096) {
+			size_t alloc = menu->pipe.alloc ? menu->pipe.alloc * 2
+				: 16384;
+			char *buf = realloc(menu->pipe.buf, alloc);
+			if (!buf) {
+				break;
+			}
+			menu->pipe.buf = buf;
+			menu->pipe.alloc = alloc;
+		}
+		ssize_t n = read(fd, menu->pipe.buf + menu->pipe.len,
+			menu->pipe.alloc - menu->pipe.len);
+		if (n > 0) {
+			menu->pipe.len += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && errno == EAGAIN) {
+			/* the command has not finished yet */
+			return 0;
+		}
+		break;
+	}
+	pipe_menu_fill(menu);
+	return 0;
+}
+
+/* run the command of a pipe menu unless its last output is recent enough */
+static void
+pipe_menu_update(struct menu *menu)
+{
+	if (!menu->execute || menu->pipe.fd >= 0) {
 		return;
 	}
-	wlr_log(WLR_INFO, "read menu file %s", menuxml);
-	buf_init(&b);
-	while (getline(&line, &len, stream) != -1) {
-		char *p = strrchr(line, '\n');
-		if (p)
-			*p = '\0';
-		buf_add(&b, line);
-	}
-	free(line);
-	fclose(stream);
-	xmlDoc *d = xmlParseMemory(b.buf, b.len);
-	if (!d) {
-		wlr_log(WLR_ERROR, "xmlParseMemory()");
-		exit(EXIT_FAILURE);
+	if (menu->pipe.updated_ms
+			&& now_ms() - menu->pipe.updated_ms < PIPE_MENU_TTL_MS) {
+		return;
+	}
+	int fd = spawn_piped(menu->execute);
+	if (fd < 0) {
+		return;
 	}
-	xml_tree_walk(xmlDocGetRootElement(d), menu);
-	xmlFreeDoc(d);
-	xmlCleanupParser();
-	free(b.buf);
+	menu->pipe.fd = fd;
+	menu->pipe.source = wl_event_loop_add_fd(
+		wl_display_get_event_loop(menu->server->wl_display), fd,
+		WL_EVENT_READABLE, handle_pipe_readable, menu);
 }
 
 void
@@ -196,31 +568,110 @@ menu_init_rootmenu(struct server *server, struct menu *menu)
 	if (!has_run) {
 		LIBXML_TEST_VERSION
 		wl_list_init(&menu->menuitems);
+		wl_list_init(&menu->menus);
 		server->rootmenu = menu;
 		menu->server = server;
 	}
 
-	parse_xml("menu.xml", menu);
+	if (!menu_parse(menu)) {
+		exit(EXIT_FAILURE);
+	}
+	menu_move(menu, 100, 100);
+}
 
-	/* Default menu if no menu.xml found */
-	if (wl_list_empty(&menu->menuitems)) {
-		current_item = menuitem_create(server, menu, "Reconfigure");
-		current_item->action = strdup("Reconfigure");
-		current_item = menuitem_create(server, menu, "Exit");
-		current_item->action = strdup("Exit");
+uint64_t
+menu_hash(void)
+{
+	char menuxml[4096];
+	if (!strlen(config_dir())) {
+		return HASH_INIT;
+	}
+	snprintf(menuxml, sizeof(menuxml), "%s/menu.xml", config_dir());
+	return hash_file(HASH_INIT, menuxml);
+}
+
+bool
+menu_load(struct menu *menu)
+{
+	wl_list_init(&menu->menuitems);
+	wl_list_init(&menu->menus);
+	return menu_parse(menu);
+}
+
+static void
+retarget_items(struct menu *menu, struct menu *from, struct menu *to)
+{
+	struct menuitem *menuitem;
+	wl_list_for_each (menuitem, &menu->menuitems, link) {
+		if (menuitem->submenu == from) {
+			menuitem->submenu = to;
+		}
+	}
+}
+
+void
+menu_replace(struct menu *menu, struct menu *new)
+{
+	menu_finish(menu);
+	wl_list_insert_list(&menu->menuitems, &new->menuitems);
+	wl_list_init(&new->menuitems);
+	wl_list_insert_list(&menu->menus, &new->menus);
+	wl_list_init(&new->menus);
+
+	/* submenus were read without a server, and may refer to the root */
+	retarget_items(menu, new, menu);
+	struct menu *m;
+	wl_list_for_each (m, &menu->menus, link) {
+		m->server = menu->server;
+		retarget_items(m, new, menu);
 	}
 	menu_move(menu, 100, 100);
 }
 
+void
+menu_texture_create(struct menu *menu)
+{
+	struct menuitem *menuitem;
+	wl_list_for_each (menuitem, &menu->menuitems, link) {
+		menuitem_texture_create(menu->server, menuitem, false);
+		if (menuitem->selected) {
+			menuitem_texture_create(menu->server, menuitem, true);
+		}
+	}
+}
+
+static void
+menu_texture_destroy(struct menu *menu)
+{
+	struct menuitem *menuitem;
+	wl_list_for_each (menuitem, &menu->menuitems, link) {
+		menuitem_texture_destroy(menuitem);
+	}
+}
+
+void
+menu_texture_invalidate(struct menu *menu)
+{
+	menu_texture_destroy(menu);
+	struct menu *m;
+	wl_list_for_each (m, &menu->menus, link) {
+		menu_texture_destroy(m);
+	}
+	if (menu->server->input_mode == LAB_INPUT_STATE_MENU) {
+		for (m = menu; m; m = m->open) {
+			menu_texture_create(m);
+		}
+	}
+}
+
 void
 menu_finish(struct menu *menu)
 {
-	struct menuitem *menuitem, *next;
-	wl_list_for_each_safe(menuitem, next, &menu->menuitems, link) {
-		zfree(menuitem->action);
-		zfree(menuitem->command);
-		wl_list_remove(&menuitem->link);
-		free(menuitem);
+	menu->open = NULL;
+	menu_items_free(menu);
+	struct menu *m, *next;
+	wl_list_for_each_safe (m, next, &menu->menus, link) {
+		menu_free(m);
 	}
 }
 
@@ -233,44 +684,158 @@ menu_move(struct menu *menu, int x, int y)
 {
 	menu->box.x = x;
 	menu->box.y = y;
+	menu->open = NULL;
+	if (menu->selected) {
+		menu->selected->selected = false;
+		menu->selected = NULL;
+	}
+
+	/* index items top to bottom for menuitem_at() */
+	int nr_items = wl_list_length(&menu->menuitems);
+	struct menuitem **items = realloc(menu->items,
+		nr_items * sizeof(struct menuitem *));
+	if (items || !nr_items) {
+		menu->items = items;
+		menu->nr_items = nr_items;
+	} else {
+		zfree(menu->items);
+		menu->nr_items = 0;
+	}
 
-	int offset = 0;
+	int offset = 0, i = 0;
 	struct menuitem *menuitem;
 	wl_list_for_each_reverse (menuitem, &menu->menuitems, link) {
 		menuitem->box.x = menu->box.x;
 		menuitem->box.y = menu->box.y + offset;
 		offset += menuitem->box.height;
+		if (i < menu->nr_items) {
+			menu->items[i++] = menuitem;
+		}
 	}
 
 	menu->box.width = MENUWIDTH;
 	menu->box.height = offset;
 }
 
-void
-menu_set_selected(struct menu *menu, int x, int y)
+/* damage @menu and the submenus shown from it */
+static void
+menu_damage(struct menu *menu)
 {
-	struct menuitem *menuitem;
-	wl_list_for_each (menuitem, &menu->menuitems, link) {
-		menuitem->selected =
-			wlr_box_contains_point(&menuitem->box, x, y);
+	for (; menu; menu = menu->open) {
+		damage_box(menu->server, &menu->box);
 	}
 }
 
-void
-menu_action_selected(struct server *server, struct menu *menu)
+/* show the submenu of @menuitem next to it */
+static void
+submenu_open(struct menu *menu, struct menuitem *menuitem)
 {
-	struct menuitem *menuitem;
-	wl_list_for_each (menuitem, &menu->menuitems, link) {
-		if (menuitem->selected) {
-			action(server, menuitem->action, menuitem->command);
+	struct menu *submenu = menuitem->submenu;
+
+	/* a menu may contain itself, but is only shown once */
+	for (struct menu *m = menu->server->rootmenu; m; m = m->open) {
+		if (m == submenu) {
+			return;
+		}
+		if (m == menu) {
 			break;
 		}
 	}
+	menu->open = submenu;
+	menu_move(submenu, menuitem->box.x + menuitem->box.width,
+		menuitem->box.y);
+	pipe_menu_update(submenu);
+	menu_texture_create(submenu);
+	damage_box(menu->server, &submenu->box);
+}
+
+/* the innermost shown menu containing (x, y) */
+static struct menu *
+menu_at(struct menu *menu, int x, int y)
+{
+	struct menu *found = NULL;
+	for (struct menu *m = menu; m; m = m->open) {
+		if (wlr_box_contains_point(&m->box, x, y)) {
+			found = m;
+		}
+	}
+	return found;
+}
+
+/* items are MENUHEIGHT tall and stacked, so the index is y / MENUHEIGHT */
+static struct menuitem *
+menuitem_at(struct menu *menu, int x, int y)
+{
+	if (!wlr_box_contains_point(&menu->box, x, y)) {
+		return NULL;
+	}
+	int i = (y - menu->box.y) / MENUHEIGHT;
+	return i < menu->nr_items ? menu->items[i] : NULL;
+}
+
+/* return false if @menuitem was selected already */
+static bool
+menu_select(struct menu *menu, struct menuitem *menuitem)
+{
+	struct menuitem *old = menu->selected;
+	if (old == menuitem) {
+		return false;
+	}
+	if (old) {
+		old->selected = false;
+		damage_box(menu->server, &old->box);
+	}
+	if (menuitem) {
+		menuitem->selected = true;
+		menuitem_texture_create(menu->server, menuitem, true);
+		damage_box(menu->server, &menuitem->box);
+	}
+	menu->selected = menuitem;
+	return true;
 }
 
 void
-menu_reconfigure(struct server *server, struct menu *menu)
+menu_set_selected(struct menu *menu, int x, int y)
 {
-	menu_finish(menu);
-	menu_init_rootmenu(server, menu);
+	struct menu *target = menu_at(menu, x, y);
+	if (!target) {
+		/* keep the items leading to the innermost menu selected */
+		target = menu;
+		while (target->open) {
+			target = target->open;
+		}
+		menu_select(target, NULL);
+		return;
+	}
+
+	struct menuitem *menuitem = menuitem_at(target, x, y);
+	if (!menu_select(target, menuitem)) {
+		return;
+	}
+	if (target->open) {
+		menu_damage(target->open);
+		target->open = NULL;
+	}
+	if (menuitem && menuitem->submenu) {
+		submenu_open(target, menuitem);
+	}
+}
+
+bool
+menu_action_selected(struct server *server, struct menu *menu)
+{
+	struct menu *target = menu_at(menu, server->seat.cursor->x,
+		server->seat.cursor->y);
+	if (!target) {
+		return false;
+	}
+	struct menuitem *menuitem = target->selected;
+	if (!menuitem) {
+		return false;
+	}
+	if (menuitem->submenu) {
+		return true;
+	}
+	action(server, menuitem->action, menuitem->command);
+	return false;
 }
@@ -1,10 +1,10 @@
 #include "config.h"
 #include <cairo.h>
-#include <drm_fourcc.h>
 #include <pango/pangocairo.h>
 #include <wlr/util/log.h>
 #include "common/buf.h"
 #include "common/font.h"
+#include "common/timing.h"
 #include "config/rcxml.h"
 #include "labwc.h"
 
@@ -68,12 +68,33 @@ get_osd_height(struct wl_list *views)
 	return height;
 }
 
-void
-osd_update(struct server *server)
+/* snapshot of the window list, so that it can be drawn off the event loop */
+struct osd_args {
+	int width;
+	int height;
+	int highlight_y; /* -1 if no item is highlighted */
+	char **lines;
+	int nr_lines;
+};
+
+static void
+osd_args_free(void *data)
+{
+	struct osd_args *args = data;
+	for (int i = 0; i < args->nr_lines; i++) {
+		free(args->lines[i]);
+	}
+	free(args->lines);
+	free(args);
+}
+
+/* runs on the font worker thread, so must only use args */
+static cairo_surface_t *
+osd_render(void *data)
 {
-	struct wlr_renderer *renderer = server->renderer;
-	int w = OSD_ITEM_WIDTH + 2 * OSD_BORDER_WIDTH;
-	int h = get_osd_height(&server->views);
+	struct osd_args *args = data;
+	int w = args->width;
+	int h = args->height;
 
 	cairo_surface_t *surf =
 		cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
@@ -85,20 +106,11 @@ osd_update(struct server *server)
 	cairo_fill(cairo);
 
 	/* highlight current application */
-	int y = OSD_BORDER_WIDTH;
-	struct view *view;
-	wl_list_for_each(view, &server->views, link) {
-		if (!isfocusable(view)) {
-			continue;
-		}
-		if (view == server->cycle_view) {
-			set_source(cairo, (float[4]){0.3f, 0.3f, 0.3f, 0.5f});
-			cairo_rectangle(cairo, OSD_BORDER_WIDTH, y,
-				OSD_ITEM_WIDTH, OSD_ITEM_HEIGHT);
-			cairo_fill(cairo);
-			break;
-		}
-		y += OSD_ITEM_HEIGHT;
+	if (args->highlight_y >= 0) {
+		set_source(cairo, (float[4]){0.3f, 0.3f, 0.3f, 0.5f});
+		cairo_rectangle(cairo, OSD_BORDER_WIDTH, args->highlight_y,
+			OSD_ITEM_WIDTH, OSD_ITEM_HEIGHT);
+		cairo_fill(cairo);
 	}
 
 	/* text */
@@ -120,19 +132,56 @@ osd_update(struct server *server)
 
 	pango_cairo_update_layout(cairo, layout);
 
-	struct buf buf;
-	buf_init(&buf);
-	y = OSD_BORDER_WIDTH;
+	int y = OSD_BORDER_WIDTH;
 
 	/* vertically center align */
 	y += (OSD_ITEM_HEIGHT - font_height("sans 10")) / 2;
 
+	for (int i = 0; i < args->nr_lines; i++) {
+		cairo_move_to(cairo, OSD_BORDER_WIDTH + OSD_ITEM_PADDING, y);
+		pango_layout_set_text(layout, args->lines[i], -1);
+		pango_cairo_show_layout(cairo, layout);
+		y += OSD_ITEM_HEIGHT;
+	}
+
+	g_object_unref(layout);
+	cairo_destroy(cairo);
+	cairo_surface_flush(surf);
+	return surf;
+}
+
+static void
+handle_osd_ready(void *data)
+{
+	struct server *server = data;
+	damage_all_outputs(server);
+}
+
+void
+osd_update(struct server *server)
+{
+	uint64_t start = timing_begin();
+	struct osd_args *args = calloc(1, sizeof(*args));
+	args->width = OSD_ITEM_WIDTH + 2 * OSD_BORDER_WIDTH;
+	args->height = get_osd_height(&server->views);
+	args->highlight_y = -1;
+	args->lines = calloc(wl_list_length(&server->views),
+		sizeof(char *));
+
+	struct buf buf;
+	buf_init(&buf);
+	int y = OSD_BORDER_WIDTH;
+	struct view *view;
 	wl_list_for_each(view, &server->views, link) {
 		if (!isfocusable(view)) {
 			continue;
 		}
+		if (view == server->cycle_view) {
+			args->highlight_y = y;
+		}
+		y += OSD_ITEM_HEIGHT;
 		buf.len = 0;
-		cairo_move_to(cairo, OSD_BORDER_WIDTH + OSD_ITEM_PADDING, y);
+		buf.buf[0] = '\0';
 
 		switch (view->type) {
 		case LAB_XDG_SHELL_VIEW:
@@ -152,25 +201,12 @@ osd_update(struct server *server)
 		if (is_title_different(view)) {
 			buf_add(&buf, view->impl->get_string_prop(view, "title"));
 		}
-
-		pango_layout_set_text(layout, buf.buf, -1);
-		pango_cairo_show_layout(cairo, layout);
-		y += OSD_ITEM_HEIGHT;
+		args->lines[args->nr_lines++] = strdup(buf.buf);
 	}
+	free(buf.buf);
 
-	g_object_unref(layout);
-
-	/* convert to wlr_texture */
-	cairo_surface_flush(surf);
-	unsigned char *data = cairo_image_surface_get_data(surf);
-	struct wlr_texture *texture = wlr_texture_from_pixels(renderer,
-		DRM_FORMAT_ARGB8888, cairo_image_surface_get_stride(surf),
-		w, h, data);
-
-	cairo_destroy(cairo);
-	cairo_surface_destroy(surf);
-	if (server->osd) {
-		wlr_texture_destroy(server->osd);
-	}
-	server->osd = texture;
+	/* the previous osd stays on screen until the new one is ready */
+	font_texture_render_async(server, &server->osd, osd_render, args,
+		osd_args_free, handle_osd_ready, server);
+	timing_end("osd_update", start);
 }
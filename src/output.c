@@ -12,6 +12,8 @@
 #include <wlr/types/wlr_output_damage.h>
 #include <wlr/util/region.h>
 #include <wlr/util/log.h>
+#include "common/font.h"
+#include "common/timing.h"
 #include "labwc.h"
 #include "layers.h"
 #include "menu/menu.h"
@@ -125,9 +127,14 @@ scissor_output(struct wlr_output *output, pixman_box32_t *rect)
 	wlr_renderer_scissor(renderer, &box);
 }
 
+/*
+ * render_subtexture - render part of a texture
+ * @src_box: area of texture to render or NULL for all of it
+ */
 static void
-render_texture(struct wlr_output *wlr_output, pixman_region32_t *output_damage,
-		struct wlr_texture *texture, const struct wlr_box *box,
+render_subtexture(struct wlr_output *wlr_output,
+		pixman_region32_t *output_damage, struct wlr_texture *texture,
+		const struct wlr_fbox *src_box, const struct wlr_box *box,
 		const float matrix[static 9])
 {
 	struct wlr_renderer *renderer =
@@ -146,13 +153,70 @@ render_texture(struct wlr_output *wlr_output, pixman_region32_t *output_damage,
 	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
 	for (int i = 0; i < nrects; i++) {
 		scissor_output(wlr_output, &rects[i]);
-		wlr_render_texture_with_matrix(renderer, texture, matrix, 1.0f);
+		if (src_box) {
+			wlr_render_subtexture_with_matrix(renderer, texture,
+				src_box, matrix, 1.0f);
+		} else {
+			wlr_render_texture_with_matrix(renderer, texture,
+				matrix, 1.0f);
+		}
 	}
 
 damage_finish:
 	pixman_region32_fini(&damage);
 }
 
+static void
+render_texture(struct wlr_output *wlr_output, pixman_region32_t *output_damage,
+		struct wlr_texture *texture, const struct wlr_box *box,
+		const float matrix[static 9])
+{
+	render_subtexture(wlr_output, output_damage, texture, NULL, box,
+		matrix);
+}
+
+static struct theme_assets *
+output_theme_assets(struct output *output)
+{
+	return theme_assets_get(output->server->theme,
+		output->wlr_output->scale);
+}
+
+/*
+ * render_atlas_region - render theme image into box (in layout coordinates)
+ * @region: region of the atlas of output_theme_assets()
+ */
+static void
+render_atlas_region(struct output *output, pixman_region32_t *output_damage,
+		struct wlr_box *_box, struct atlas_region *region)
+{
+	struct theme_assets *assets = output_theme_assets(output);
+	struct wlr_texture *atlas = assets ? assets->atlas : NULL;
+	if (!atlas || !region->width || !region->height) {
+		return;
+	}
+	struct wlr_box box = *_box;
+
+	double ox = 0, oy = 0;
+	wlr_output_layout_output_coords(output->server->output_layout,
+		output->wlr_output, &ox, &oy);
+	box.x += ox;
+	box.y += oy;
+	scale_box(&box, output->wlr_output->scale);
+
+	struct wlr_fbox src_box = {
+		.x = region->x,
+		.y = region->y,
+		.width = region->width,
+		.height = region->height,
+	};
+	float matrix[9];
+	wlr_matrix_project_box(matrix, &box, WL_OUTPUT_TRANSFORM_NORMAL, 0,
+		output->wlr_output->transform_matrix);
+	render_subtexture(output->wlr_output, output_damage, atlas, &src_box,
+		&box, matrix);
+}
+
 static void
 render_surface_iterator(struct output *output, struct wlr_surface *surface,
 		struct wlr_box *box, void *user_data)
@@ -240,6 +304,26 @@ output_view_for_each_popup_surface(struct output *output, struct view *view,
 	view_for_each_popup_surface(view, output_for_each_surface_iterator, &data);
 }
 
+static void
+output_layer_for_each_popup_surface(struct output *output,
+		struct wl_list *layer_surfaces, surface_iterator_func_t iterator,
+		void *user_data)
+{
+	struct lab_layer_surface *layer_surface;
+	wl_list_for_each(layer_surface, layer_surfaces, link) {
+		struct surface_iterator_data data = {
+			.user_iterator = iterator,
+			.user_data = user_data,
+			.output = output,
+			.ox = layer_surface->geo.x,
+			.oy = layer_surface->geo.y,
+		};
+		wlr_layer_surface_v1_for_each_popup_surface(
+			layer_surface->layer_surface,
+			output_for_each_surface_iterator, &data);
+	}
+}
+
 /* for sending frame done */
 void output_layer_for_each_surface(struct output *output,
 		struct wl_list *layer_surfaces, surface_iterator_func_t iterator,
@@ -251,58 +335,148 @@ void output_layer_for_each_surface(struct output *output,
 		output_surface_for_each_surface(output, wlr_layer_surface_v1->surface,
 			layer_surface->geo.x, layer_surface->geo.y, iterator,
 			user_data);
-		/* TODO: handle popups */
 	}
+	output_layer_for_each_popup_surface(output, layer_surfaces, iterator,
+		user_data);
+}
+
+struct send_frame_done_data {
+	struct timespec when;
+};
+
+static void
+send_frame_done_iterator(struct output *output, struct wlr_surface *surface,
+		struct wlr_box *box, void *user_data)
+{
+	struct send_frame_done_data *data = user_data;
+	wlr_surface_send_frame_done(surface, &data->when);
+}
+
+/* Frame callbacks to occluded views are throttled to this interval */
+#define HIDDEN_VIEW_FRAME_INTERVAL_MS (1000)
+
+/*
+ * Returns true if any part of @view within @area is not covered by @opaque,
+ * all in layout coordinates. The cached extents are tested as a rectangle
+ * first, so that only views which are partly covered need region maths.
+ */
+static bool
+view_is_visible(struct view *view, pixman_region32_t *area,
+		pixman_region32_t *opaque)
+{
+	if (!pixman_region32_not_empty(&view->extents)) {
+		return false;
+	}
+	pixman_box32_t *box = pixman_region32_extents(&view->extents);
+	if (pixman_region32_contains_rectangle(area, box) ==
+			PIXMAN_REGION_OUT) {
+		return false;
+	}
+	pixman_region32_overlap_t covered =
+		pixman_region32_contains_rectangle(opaque, box);
+	if (covered == PIXMAN_REGION_IN) {
+		return false;
+	} else if (covered == PIXMAN_REGION_OUT) {
+		return true;
+	}
+	pixman_region32_t visible;
+	pixman_region32_init(&visible);
+	pixman_region32_intersect(&visible, &view->extents, area);
+	pixman_region32_subtract(&visible, &visible, opaque);
+	bool is_visible = pixman_region32_not_empty(&visible);
+	pixman_region32_fini(&visible);
+	return is_visible;
 }
 
+/*
+ * Returns true if @view is due another frame callback whilst occluded;
+ * otherwise sets @wait_ms to the time until it will be.
+ */
+static bool
+hidden_view_frame_due(struct view *view, struct timespec *now, long *wait_ms)
+{
+	long ms = (now->tv_sec - view->hidden_frame_done.tv_sec) * 1000 +
+		(now->tv_nsec - view->hidden_frame_done.tv_nsec) / 1000000;
+	if (ms < HIDDEN_VIEW_FRAME_INTERVAL_MS) {
+		*wait_ms = HIDDEN_VIEW_FRAME_INTERVAL_MS - ms;
+		return false;
+	}
+	view->hidden_frame_done = *now;
+	return true;
+}
+
+static int
+handle_hidden_frame_timer(void *data)
+{
+	struct output *output = data;
+	output->hidden_frame_pending = false;
+	wlr_output_schedule_frame(output->wlr_output);
+	return 0;
+}
+
+/*
+ * Minimized views are not mapped and therefore get no frame callbacks at
+ * all. Views which are completely covered by others only get them once a
+ * second so that they stop animating without stalling altogether. Whilst
+ * any are waiting, a timer schedules a frame for when the next one is due,
+ * so that they keep getting them on an otherwise idle output.
+ */
 static void
-output_for_each_surface(struct output *output, surface_iterator_func_t iterator,
-		void *user_data)
+send_frame_done(struct output *output, struct send_frame_done_data *data)
 {
 	output_layer_for_each_surface(output,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND],
-		iterator, user_data);
+		send_frame_done_iterator, data);
 	output_layer_for_each_surface(output,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM],
-		iterator, user_data);
+		send_frame_done_iterator, data);
 
-	struct view *view;
-	wl_list_for_each_reverse(view, &output->server->views, link) {
-		if (!view->mapped) {
+	struct server *server = output->server;
+	struct wlr_box *output_box = wlr_output_layout_get_box(
+		server->output_layout, output->wlr_output);
+	pixman_region32_t output_region, opaque;
+	pixman_region32_init_rect(&output_region, output_box->x,
+		output_box->y, output_box->width, output_box->height);
+	pixman_region32_init(&opaque);
+	long next_due_ms = -1;
+	for (int i = 0; i < server->nr_mapped_views; i++) {
+		struct view *view = server->mapped_views[i];
+		if (!view_on_output(view, output)) {
 			continue;
 		}
-		output_view_for_each_surface(output, view, iterator, user_data);
+		bool occluded = !view_is_visible(view, &output_region, &opaque);
+		pixman_region32_union(&opaque, &opaque, &view->opaque);
+		long wait_ms;
+		if (occluded &&
+				!hidden_view_frame_due(view, &data->when, &wait_ms)) {
+			if (next_due_ms < 0 || wait_ms < next_due_ms) {
+				next_due_ms = wait_ms;
+			}
+			continue;
+		}
+		output_view_for_each_surface(output, view,
+			send_frame_done_iterator, data);
 	}
+	if (next_due_ms >= 0 && !output->hidden_frame_pending) {
+		output->hidden_frame_pending = true;
+		wl_event_source_timer_update(output->hidden_frame_timer,
+			next_due_ms);
+	}
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&output_region);
 
 #if HAVE_XWAYLAND
-	output_unmanaged_for_each_surface(output, &output->server->unmanaged_surfaces,
-		iterator, user_data);
+	output_unmanaged_for_each_surface(output,
+		&output->server->unmanaged_surfaces, send_frame_done_iterator,
+		data);
 #endif
 
 	output_layer_for_each_surface(output,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP],
-		iterator, user_data);
+		send_frame_done_iterator, data);
 	output_layer_for_each_surface(output,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY],
-		iterator, user_data);
-}
-
-struct send_frame_done_data {
-	struct timespec when;
-};
-
-static void
-send_frame_done_iterator(struct output *output, struct wlr_surface *surface,
-		struct wlr_box *box, void *user_data)
-{
-	struct send_frame_done_data *data = user_data;
-	wlr_surface_send_frame_done(surface, &data->when);
-}
-
-static void
-send_frame_done(struct output *output, struct send_frame_done_data *data)
-{
-	output_for_each_surface(output, send_frame_done_iterator, data);
+		send_frame_done_iterator, data);
 }
 
 void
@@ -402,12 +576,13 @@ render_cycle_box(struct output *output, pixman_region32_t *output_damage,
 
 static void
 render_icon(struct output *output, pixman_region32_t *output_damage,
-		struct wlr_box *box, struct wlr_texture *texture)
+		struct wlr_box *box, struct atlas_region *region)
 {
 	/* centre-align icon if smaller than designated box */
+	float scale = output->wlr_output->scale;
 	struct wlr_box button = {
-		.width = texture->width,
-		.height = texture->height,
+		.width = round(region->width / scale),
+		.height = round(region->height / scale),
 	};
 	if (box->width > button.width) {
 		button.x = box->x + (box->width - button.width) / 2;
@@ -421,19 +596,7 @@ render_icon(struct output *output, pixman_region32_t *output_damage,
 		button.y = box->y;
 		button.height = box->height;
 	}
-
-	double ox = 0, oy = 0;
-	wlr_output_layout_output_coords(output->server->output_layout,
-		output->wlr_output, &ox, &oy);
-	button.x += ox;
-	button.y += oy;
-	scale_box(&button, output->wlr_output->scale);
-
-	float matrix[9];
-	wlr_matrix_project_box(matrix, &button, WL_OUTPUT_TRANSFORM_NORMAL, 0,
-		output->wlr_output->transform_matrix);
-	render_texture(output->wlr_output, output_damage, texture, &button,
-		matrix);
+	render_atlas_region(output, output_damage, &button, region);
 }
 
 void
@@ -482,12 +645,24 @@ render_osd(struct output *output, pixman_region32_t *damage,
 	}
 }
 
-static bool
-isbutton(enum ssd_part_type type)
+/*
+ * render_button - render titlebar button in its current state
+ * @hovered: button under the cursor, if any
+ * @states: atlas regions indexed by enum button_state
+ */
+static void
+render_button(struct output *output, pixman_region32_t *output_damage,
+		struct view *view, enum ssd_part_type type,
+		enum ssd_part_type hovered, struct atlas_region *states)
 {
-	return type == LAB_SSD_BUTTON_CLOSE ||
-	       type == LAB_SSD_BUTTON_MAXIMIZE ||
-	       type == LAB_SSD_BUTTON_ICONIFY;
+	enum button_state state = LAB_BUTTON_UNPRESSED;
+	if (type == hovered) {
+		struct wlr_seat *seat = view->server->seat.seat;
+		state = seat->pointer_state.button_count ?
+			LAB_BUTTON_PRESSED : LAB_BUTTON_HOVER;
+	}
+	struct wlr_box box = ssd_box(view, type);
+	render_icon(output, output_damage, &box, &states[state]);
 }
 
 static void
@@ -500,16 +675,31 @@ render_deco(struct view *view, struct output *output,
 
 	struct wlr_seat *seat = view->server->seat.seat;
 	bool focused = view->surface == seat->keyboard_state.focused_surface;
+	struct theme_assets *assets = output_theme_assets(output);
 
 	/* render texture or rectangle */
-	struct ssd_part *part;
-	wl_list_for_each_reverse(part, &view->ssd.parts, link) {
+	for (int i = 0; i < view->ssd.nr_parts; i++) {
+		struct ssd_part *part = &view->ssd.parts[i];
 		if (part->texture.active && *(part->texture.active)) {
 			struct wlr_texture *texture = focused ?
 				*(part->texture.active) :
 				*(part->texture.inactive);
 			render_texture_helper(output, output_damage, &part->box,
 					      texture);
+		} else if (part->type == LAB_SSD_PART_CORNER_TOP_LEFT) {
+			if (assets) {
+				render_atlas_region(output, output_damage,
+					&part->box, focused ?
+					&assets->corner_top_left_active_normal :
+					&assets->corner_top_left_inactive_normal);
+			}
+		} else if (part->type == LAB_SSD_PART_CORNER_TOP_RIGHT) {
+			if (assets) {
+				render_atlas_region(output, output_damage,
+					&part->box, focused ?
+					&assets->corner_top_right_active_normal :
+					&assets->corner_top_right_inactive_normal);
+			}
 		} else if (part->color.active && part->color.inactive) {
 			float *color = focused ?
 				part->color.active :
@@ -520,41 +710,45 @@ render_deco(struct view *view, struct output *output,
 
 	/* button background */
 	struct wlr_cursor *cur = view->server->seat.cursor;
-	enum ssd_part_type type = ssd_at(view, cur->x, cur->y);
-	struct wlr_box box = ssd_box(view, type);
-	if (isbutton(type) &&
+	enum ssd_part_type hovered = ssd_at(view, cur->x, cur->y);
+	struct wlr_box box = ssd_box(view, hovered);
+	if (ssd_is_button(hovered) &&
 			wlr_box_contains_point(&box, cur->x, cur->y)) {
 		float *color = (float[4]){ 0.5, 0.5, 0.5, 0.5 };
 		render_rect(output, output_damage, &box, color);
+	} else {
+		hovered = LAB_SSD_NONE;
 	}
 
-	/* buttons */
-	struct theme *theme = view->server->theme;
-	if (view->surface == seat->keyboard_state.focused_surface) {
-		box = ssd_box(view, LAB_SSD_BUTTON_CLOSE);
-		render_icon(output, output_damage, &box,
-			theme->xbm_close_active_unpressed);
-		box = ssd_box(view, LAB_SSD_BUTTON_MAXIMIZE);
-		render_icon(output, output_damage, &box,
-			theme->xbm_maximize_active_unpressed);
-		box = ssd_box(view, LAB_SSD_BUTTON_ICONIFY);
-		render_icon(output, output_damage, &box,
-			theme->xbm_iconify_active_unpressed);
+	/* buttons; no images for this scale if theme_assets_update() failed */
+	if (!assets) {
+		return;
+	}
+	if (focused) {
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_CLOSE, hovered, assets->xbm_close_active);
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_MAXIMIZE, hovered,
+			assets->xbm_maximize_active);
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_ICONIFY, hovered,
+			assets->xbm_iconify_active);
 	} else {
-		box = ssd_box(view, LAB_SSD_BUTTON_CLOSE);
-		render_icon(output, output_damage, &box,
-			theme->xbm_close_inactive_unpressed);
-		box = ssd_box(view, LAB_SSD_BUTTON_MAXIMIZE);
-		render_icon(output, output_damage, &box,
-			theme->xbm_maximize_inactive_unpressed);
-		box = ssd_box(view, LAB_SSD_BUTTON_ICONIFY);
-		render_icon(output, output_damage, &box,
-			theme->xbm_iconify_inactive_unpressed);
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_CLOSE, hovered,
+			assets->xbm_close_inactive);
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_MAXIMIZE, hovered,
+			assets->xbm_maximize_inactive);
+		render_button(output, output_damage, view,
+			LAB_SSD_BUTTON_ICONIFY, hovered,
+			assets->xbm_iconify_inactive);
 	}
 }
 
 static void
-render_rootmenu(struct output *output, pixman_region32_t *output_damage)
+render_menu(struct output *output, pixman_region32_t *output_damage,
+		struct menu *menu)
 {
 	struct server *server = output->server;
 	struct theme *theme = server->theme;
@@ -566,30 +760,41 @@ render_rootmenu(struct output *output, pixman_region32_t *output_damage)
 		&ox, &oy);
 
 	/* background */
-	render_rect(output, output_damage, &server->rootmenu->box,
+	render_rect(output, output_damage, &menu->box,
 		theme->menu_items_bg_color);
 
 	/* items */
 	struct menuitem *menuitem;
-	wl_list_for_each (menuitem, &server->rootmenu->menuitems, link) {
+	wl_list_for_each (menuitem, &menu->menuitems, link) {
+		struct wlr_texture *texture = menuitem->selected ?
+			menuitem->texture.active : menuitem->texture.inactive;
+		if (menuitem->selected) {
+			render_rect(output, output_damage, &menuitem->box,
+				theme->menu_items_active_bg_color);
+		}
+		if (!texture) {
+			continue;
+		}
 		struct wlr_box box = {
 			.x = menuitem->box.x + menuitem->texture.offset_x + ox,
 			.y = menuitem->box.y + menuitem->texture.offset_y + oy,
-			.width = menuitem->texture.active->width,
-			.height = menuitem->texture.active->height,
 		};
+		font_texture_size(server, texture, &box.width, &box.height);
 		scale_box(&box, output->wlr_output->scale);
 		wlr_matrix_project_box(matrix, &box, WL_OUTPUT_TRANSFORM_NORMAL,
 			0, output->wlr_output->transform_matrix);
-		if (menuitem->selected) {
-			render_rect(output, output_damage, &menuitem->box,
-				theme->menu_items_active_bg_color);
-			render_texture(output->wlr_output, output_damage,
-				menuitem->texture.active, &box, matrix);
-		} else {
-			render_texture(output->wlr_output, output_damage,
-				menuitem->texture.inactive, &box, matrix);
-		}
+		render_texture(output->wlr_output, output_damage, texture, &box,
+			matrix);
+	}
+}
+
+/* render the root menu and the submenus opened from it */
+static void
+render_rootmenu(struct output *output, pixman_region32_t *output_damage)
+{
+	struct menu *menu = output->server->rootmenu;
+	for (; menu; menu = menu->open) {
+		render_menu(output, output_damage, menu);
 	}
 }
 
@@ -616,6 +821,17 @@ static void render_layer_toplevel(struct output *output,
 		render_surface_iterator, &data);
 }
 
+static void
+render_layer_popups(struct output *output, pixman_region32_t *damage,
+		struct wl_list *layer_surfaces)
+{
+	struct render_data data = {
+		.damage = damage,
+	};
+	output_layer_for_each_popup_surface(output, layer_surfaces,
+		render_surface_iterator, &data);
+}
+
 static void
 render_view_toplevels(struct view *view, struct output *output,
 		pixman_region32_t *damage)
@@ -641,6 +857,39 @@ render_view_popups(struct view *view, struct output *output,
 	output_view_for_each_popup_surface(output, view, render_surface_iterator, &data);
 }
 
+/*
+ * Mark views which do not need rendering because they are outside the
+ * damaged area or hidden behind opaque views above them. This works from
+ * the extents and opaque regions cached in each view, so that no surfaces
+ * are walked to render a frame.
+ * @damage: in output buffer coordinates
+ */
+static void
+cull_views(struct output *output, pixman_region32_t *damage)
+{
+	struct server *server = output->server;
+	struct wlr_box *output_box = wlr_output_layout_get_box(
+		server->output_layout, output->wlr_output);
+
+	/* be conservative: expand damage when converting to layout coords */
+	pixman_region32_t layout_damage;
+	pixman_region32_init(&layout_damage);
+	wlr_region_scale(&layout_damage, damage,
+		1.0f / output->wlr_output->scale);
+	pixman_region32_translate(&layout_damage, output_box->x,
+		output_box->y);
+
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	for (int i = 0; i < server->nr_mapped_views; i++) {
+		struct view *view = server->mapped_views[i];
+		view->culled = !view_is_visible(view, &layout_damage, &opaque);
+		pixman_region32_union(&opaque, &opaque, &view->opaque);
+	}
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&layout_damage);
+}
+
 void
 output_render(struct output *output, pixman_region32_t *damage)
 {
@@ -678,9 +927,10 @@ output_render(struct output *output, pixman_region32_t *damage)
 	render_layer_toplevel(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
 
-	struct view *view;
-	wl_list_for_each_reverse (view, &server->views, link) {
-		if (!view->mapped) {
+	cull_views(output, damage);
+	for (int i = server->nr_mapped_views - 1; i >= 0; i--) {
+		struct view *view = server->mapped_views[i];
+		if (view->culled) {
 			continue;
 		}
 		render_deco(view, output, damage);
@@ -700,8 +950,19 @@ output_render(struct output *output, pixman_region32_t *damage)
 
 	render_layer_toplevel(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+
+	/* popups of layers below overlay go on top of all windows */
+	render_layer_popups(output, damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
+	render_layer_popups(output, damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
+	render_layer_popups(output, damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+
 	render_layer_toplevel(output, damage,
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
+	render_layer_popups(output, damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
 
 	if (output->server->input_mode == LAB_INPUT_STATE_MENU) {
 		render_rootmenu(output, damage);
@@ -798,7 +1059,9 @@ output_damage_frame_notify(struct wl_listener *listener, void *data)
 	}
 
 	if (needs_frame) {
+		uint64_t start = timing_begin();
 		output_render(output, &damage);
+		timing_end("output_render", start);
 	} else {
 		wlr_output_rollback(output->wlr_output);
 	}
@@ -820,9 +1083,18 @@ output_damage_destroy_notify(struct wl_listener *listener, void *data)
 static void
 output_destroy_notify(struct wl_listener *listener, void *data)
 {
-        struct output *output = wl_container_of(listener, output, destroy);
-        wl_list_remove(&output->link);
-        wl_list_remove(&output->destroy.link);
+	struct output *output = wl_container_of(listener, output, destroy);
+	wl_list_remove(&output->link);
+	wl_list_remove(&output->destroy.link);
+	wl_event_source_remove(output->hidden_frame_timer);
+
+	/* the wl_output global goes away, so no leave events are needed */
+	struct server *server = output->server;
+	server->output_bits &= ~output->bit;
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		view->outputs &= ~output->bit;
+	}
 }
 
 static void
@@ -849,8 +1121,19 @@ new_output_notify(struct wl_listener *listener, void *data)
 	output->damage = wlr_output_damage_create(wlr_output);
 	wlr_output_effective_resolution(wlr_output,
 		&output->usable_area.width, &output->usable_area.height);
+	output->hidden_frame_timer = wl_event_loop_add_timer(
+		wl_display_get_event_loop(server->wl_display),
+		handle_hidden_frame_timer, output);
 	wl_list_insert(&server->outputs, &output->link);
 
+	for (int i = 0; i < 32; i++) {
+		if (!(server->output_bits & (1u << i))) {
+			output->bit = 1u << i;
+			server->output_bits |= output->bit;
+			break;
+		}
+	}
+
 	output->destroy.notify = output_destroy_notify;
 	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
 
@@ -897,6 +1180,7 @@ output_init(struct server *server)
 		server->output_layout);
 
 	wl_list_init(&server->outputs);
+	server->text_scale = 1.0f;
 
 	output_manager_init(server);
 }
@@ -998,8 +1282,56 @@ static struct wlr_output_configuration_v1 *create_output_config(struct server *s
 	return config;
 }
 
+/*
+ * Keep scaled images in step with the set of output scales: create theme
+ * images for new scales, drop those no longer used and re-create text
+ * textures if the highest scale has changed.
+ */
+void
+output_update_scaled_textures(struct server *server)
+{
+	float scales[wl_list_length(&server->outputs) + 1];
+	int nr_scales = 0;
+	float text_scale = 1.0f;
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		float scale = output->wlr_output->scale;
+		scales[nr_scales++] = scale;
+		if (scale > text_scale) {
+			text_scale = scale;
+		}
+	}
+	if (!server->theme) {
+		/* still starting up */
+		server->text_scale = text_scale;
+		return;
+	}
+	theme_assets_update(server->theme, scales, nr_scales);
+
+	if (text_scale == server->text_scale) {
+		return;
+	}
+	server->text_scale = text_scale;
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		if (view->ssd.enabled && view->title) {
+			ssd_update_title(view);
+		}
+	}
+	if (server->rootmenu) {
+		menu_texture_invalidate(server->rootmenu);
+	}
+	damage_all_outputs(server);
+}
+
 static void handle_output_layout_change(struct wl_listener *listener, void *data) {
 	struct server *server = wl_container_of(listener, server, output_layout_change);
+	output_update_scaled_textures(server);
+
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		view_update_outputs(view);
+	}
 
 	bool done_changing = server->pending_output_config == NULL;
 	if(done_changing) {
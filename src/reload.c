@@ -0,0 +1,430 @@
+/*
+ * Reload config, theme and menu without blocking the event loop
+ *
+ * Files are read and theme images rasterized on a short-lived thread into
+ * a new config, theme and menu. Only once everything is ready are the new
+ * objects swapped in, so the old config and theme stay in use until then.
+ * Menu item textures are created when the menu is next shown.
+ *
+ * The inputs of each part are hashed and only parts whose inputs have
+ * changed are rebuilt. The theme depends on the config (theme name, font,
+ * corner radius). The menu only depends on menu.xml, but its textures are
+ * dropped when the config or theme changes.
+ *
+ * A reload is triggered by SIGHUP, the Reconfigure action, or by rc.xml or
+ * menu.xml being written. The config directory is watched with inotify and
+ * bursts of events, as produced by editors saving files, are coalesced.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "common/dir.h"
+#include "common/timing.h"
+#include "config/rcxml.h"
+#include "labwc.h"
+#include "menu/menu.h"
+#include "ssd.h"
+#include "theme.h"
+
+/* wait for a burst of file writes to end before reloading */
+#define RELOAD_DEBOUNCE_MS (250)
+
+enum reload_part {
+	RELOAD_CONFIG = 0,
+	RELOAD_THEME,
+	RELOAD_MENU,
+	RELOAD_PART_COUNT
+};
+
+static const char *part_names[RELOAD_PART_COUNT] = {
+	[RELOAD_CONFIG] = "config",
+	[RELOAD_THEME] = "theme",
+	[RELOAD_MENU] = "menu",
+};
+
+enum reload_state {
+	RELOAD_IDLE = 0,
+	RELOAD_READING,
+};
+
+static struct {
+	struct server *server;
+	enum reload_state state;
+	bool again; /* reload requested while one was in progress */
+	pthread_t thread;
+	int eventfd;
+	struct wl_event_source *source;
+	uint64_t start;
+
+	/* watch of the config directory */
+	int inotify_fd;
+	struct wl_event_source *inotify_source;
+	struct wl_event_source *debounce_timer;
+
+	/* output scales to rasterize theme images for */
+	float *scales;
+	int nr_scales;
+
+	/* hashes of the inputs of each part in use, and of those being read */
+	uint64_t hashes[RELOAD_PART_COUNT];
+	uint64_t next_hashes[RELOAD_PART_COUNT];
+
+	bool rebuild[RELOAD_PART_COUNT];
+	uint64_t elapsed_ns[RELOAD_PART_COUNT];
+
+	/* new objects, not yet in use; only valid if rebuild[] is set */
+	struct rcxml rc;
+	struct theme theme;
+	struct menu menu;
+} reload = {
+	.eventfd = -1,
+	.inotify_fd = -1,
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static struct rcxml *
+new_config(void)
+{
+	return reload.rebuild[RELOAD_CONFIG] ? &reload.rc : &rc;
+}
+
+/* keep @part in use; it is re-read once its inputs change again */
+static void
+keep_part(enum reload_part part)
+{
+	reload.rebuild[part] = false;
+	reload.next_hashes[part] = reload.hashes[part];
+}
+
+/*
+ * Runs on the reload thread, so must not touch compositor state. The
+ * current rc is only read, and is not changed until the swap on the
+ * event loop.
+ */
+static void
+read_files(void)
+{
+	uint64_t start = now_ns();
+	reload.next_hashes[RELOAD_CONFIG] = rcxml_hash();
+	if (reload.next_hashes[RELOAD_CONFIG] != reload.hashes[RELOAD_CONFIG]) {
+		reload.rebuild[RELOAD_CONFIG] = true;
+		if (!rcxml_load(&reload.rc, NULL)) {
+			wlr_log(WLR_ERROR, "reload: keeping config, rc.xml "
+				"is malformed");
+			rcxml_free(&reload.rc);
+			keep_part(RELOAD_CONFIG);
+		}
+	}
+	reload.elapsed_ns[RELOAD_CONFIG] = now_ns() - start;
+
+	start = now_ns();
+	reload.next_hashes[RELOAD_THEME] = theme_hash(new_config());
+	if (reload.next_hashes[RELOAD_THEME] != reload.hashes[RELOAD_THEME]) {
+		reload.rebuild[RELOAD_THEME] = true;
+		theme_load(&reload.theme, new_config(), reload.scales,
+			reload.nr_scales);
+	}
+	reload.elapsed_ns[RELOAD_THEME] = now_ns() - start;
+
+	start = now_ns();
+	reload.next_hashes[RELOAD_MENU] = menu_hash();
+	if (reload.next_hashes[RELOAD_MENU] != reload.hashes[RELOAD_MENU]) {
+		reload.rebuild[RELOAD_MENU] = true;
+		if (!menu_load(&reload.menu)) {
+			wlr_log(WLR_ERROR, "reload: keeping menu, menu.xml "
+				"is malformed");
+			menu_finish(&reload.menu);
+			keep_part(RELOAD_MENU);
+		}
+	}
+	reload.elapsed_ns[RELOAD_MENU] = now_ns() - start;
+}
+
+static void
+log_parts(void)
+{
+	for (int i = 0; i < RELOAD_PART_COUNT; i++) {
+		if (reload.rebuild[i]) {
+			wlr_log(WLR_INFO, "reload: rebuilt %s in %.2f ms",
+				part_names[i], reload.elapsed_ns[i] / 1e6);
+		} else {
+			wlr_log(WLR_INFO, "reload: %s unchanged (%.2f ms)",
+				part_names[i], reload.elapsed_ns[i] / 1e6);
+		}
+	}
+}
+
+static void *
+reload_run(void *data)
+{
+	read_files();
+	uint64_t one = 1;
+	if (write(reload.eventfd, &one, sizeof(one)) < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot signal end of reload");
+	}
+	return NULL;
+}
+
+/* the title height and border width may have changed with the theme */
+static void
+update_decorations(struct server *server)
+{
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		if (!view->mapped || !view->ssd.enabled) {
+			continue;
+		}
+		view->margin = ssd_thickness(view);
+		for (int i = 0; i < view->ssd.nr_parts; i++) {
+			struct ssd_part *part = &view->ssd.parts[i];
+			part->box = ssd_box(view, part->type);
+		}
+		view_update_regions(view);
+		view_update_outputs(view);
+	}
+}
+
+static void
+swap_in(void)
+{
+	struct server *server = reload.server;
+
+	if (reload.rebuild[RELOAD_CONFIG]) {
+		rcxml_replace(&reload.rc);
+		idle_reset_timer(server);
+	}
+	if (reload.rebuild[RELOAD_THEME]) {
+		theme_replace(server->theme, &reload.theme);
+		/* in case outputs were added while the theme was read */
+		output_update_scaled_textures(server);
+	}
+	if (reload.rebuild[RELOAD_MENU]) {
+		menu_replace(server->rootmenu, &reload.menu);
+	} else if (reload.rebuild[RELOAD_CONFIG]
+			|| reload.rebuild[RELOAD_THEME]) {
+		/* font or colors may have changed */
+		menu_texture_invalidate(server->rootmenu);
+	}
+	free(reload.scales);
+	reload.scales = NULL;
+	memcpy(reload.hashes, reload.next_hashes, sizeof(reload.hashes));
+
+	if (reload.rebuild[RELOAD_THEME]) {
+		update_decorations(server);
+	}
+
+	damage_all_outputs(server);
+	reload.state = RELOAD_IDLE;
+	timing_end("reload", reload.start);
+	log_parts();
+
+	if (reload.again) {
+		reload.again = false;
+		reload_config_and_theme(server);
+	}
+}
+
+static int
+handle_files_read(int fd, uint32_t mask, void *data)
+{
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0) {
+		return 0;
+	}
+	pthread_join(reload.thread, NULL);
+	swap_in();
+	return 0;
+}
+
+static bool
+scales_collect(struct server *server)
+{
+	reload.nr_scales = 0;
+	reload.scales = calloc(wl_list_length(&server->outputs) + 1,
+		sizeof(float));
+	if (!reload.scales) {
+		return false;
+	}
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		reload.scales[reload.nr_scales++] = output->wlr_output->scale;
+	}
+	return true;
+}
+
+void
+reload_config_and_theme(struct server *server)
+{
+	if (!server->theme || !server->rootmenu) {
+		/* still starting up */
+		return;
+	}
+	if (reload.state != RELOAD_IDLE) {
+		reload.again = true;
+		return;
+	}
+	reload.start = timing_begin();
+	reload.server = server;
+	memset(&reload.rc, 0, sizeof(reload.rc));
+	memset(&reload.theme, 0, sizeof(reload.theme));
+	memset(&reload.menu, 0, sizeof(reload.menu));
+	memset(reload.rebuild, 0, sizeof(reload.rebuild));
+	if (!scales_collect(server)) {
+		return;
+	}
+
+	reload.state = RELOAD_READING;
+	if (reload.eventfd < 0
+			|| pthread_create(&reload.thread, NULL, reload_run, NULL)) {
+		wlr_log(WLR_ERROR, "cannot read config in the background");
+		read_files();
+		swap_in();
+	}
+}
+
+static int
+handle_debounce_timeout(void *data)
+{
+	wlr_log(WLR_INFO, "config file changed");
+	reload_config_and_theme(reload.server);
+	return 0;
+}
+
+static bool
+is_watched_file(const char *name)
+{
+	return !strcmp(name, "rc.xml") || !strcmp(name, "menu.xml");
+}
+
+static int
+handle_inotify(int fd, uint32_t mask, void *data)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	ssize_t len;
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		char *p = buf;
+		while (p < buf + len) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)p;
+			if (event->len && is_watched_file(event->name)) {
+				changed = true;
+			}
+			p += sizeof(*event) + event->len;
+		}
+	}
+	if (changed) {
+		/* (re)arm, so that only the last event of a burst reloads */
+		wl_event_source_timer_update(reload.debounce_timer,
+			RELOAD_DEBOUNCE_MS);
+	}
+	return 0;
+}
+
+static void
+watch_config_dir(struct server *server)
+{
+	const char *dir = config_dir();
+	if (!strlen(dir)) {
+		return;
+	}
+	reload.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (reload.inotify_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "inotify_init1()");
+		return;
+	}
+	if (inotify_add_watch(reload.inotify_fd, dir,
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+		wlr_log_errno(WLR_ERROR, "cannot watch %s", dir);
+		close(reload.inotify_fd);
+		reload.inotify_fd = -1;
+		return;
+	}
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(server->wl_display);
+	reload.inotify_source = wl_event_loop_add_fd(event_loop,
+		reload.inotify_fd, WL_EVENT_READABLE, handle_inotify, NULL);
+	reload.debounce_timer = wl_event_loop_add_timer(event_loop,
+		handle_debounce_timeout, NULL);
+}
+
+void
+reload_init(struct server *server)
+{
+	reload.server = server;
+
+	/* rc has been read at this point, and the theme and menu follow it */
+	reload.hashes[RELOAD_CONFIG] = rcxml_hash();
+	reload.hashes[RELOAD_THEME] = theme_hash(&rc);
+	reload.hashes[RELOAD_MENU] = menu_hash();
+
+	reload.eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (reload.eventfd < 0) {
+		wlr_log_errno(WLR_ERROR, "eventfd()");
+		return;
+	}
+	reload.source = wl_event_loop_add_fd(
+		wl_display_get_event_loop(server->wl_display), reload.eventfd,
+		WL_EVENT_READABLE, handle_files_read, NULL);
+
+	watch_config_dir(server);
+}
+
+void
+reload_finish(struct server *server)
+{
+	switch (reload.state) {
+	case RELOAD_READING:
+		pthread_join(reload.thread, NULL);
+		if (reload.rebuild[RELOAD_MENU]) {
+			menu_finish(&reload.menu);
+		}
+		if (reload.rebuild[RELOAD_THEME]) {
+			theme_finish(&reload.theme);
+		}
+		if (reload.rebuild[RELOAD_CONFIG]) {
+			rcxml_free(&reload.rc);
+		}
+		free(reload.scales);
+		reload.scales = NULL;
+		reload.state = RELOAD_IDLE;
+		break;
+	case RELOAD_IDLE:
+		break;
+	}
+	if (reload.debounce_timer) {
+		wl_event_source_remove(reload.debounce_timer);
+		reload.debounce_timer = NULL;
+	}
+	if (reload.inotify_source) {
+		wl_event_source_remove(reload.inotify_source);
+		reload.inotify_source = NULL;
+	}
+	if (reload.inotify_fd >= 0) {
+		close(reload.inotify_fd);
+		reload.inotify_fd = -1;
+	}
+	if (reload.source) {
+		wl_event_source_remove(reload.source);
+		reload.source = NULL;
+	}
+	if (reload.eventfd >= 0) {
+		close(reload.eventfd);
+		reload.eventfd = -1;
+	}
+}
@@ -10,9 +10,6 @@
 #include "config/rcxml.h"
 #include "labwc.h"
 #include "layers.h"
-#include "menu/menu.h"
-#include "ssd.h"
-#include "theme.h"
 
 static struct wlr_compositor *compositor;
 static struct wl_event_source *sighup_source;
@@ -21,36 +18,10 @@ static struct wl_event_source *sigterm_source;
 
 static struct server *g_server;
 
-static void
-reload_config_and_theme(void)
-{
-	/* TODO: use rc.config_path */
-	rcxml_finish();
-	rcxml_read(NULL);
-	theme_finish(g_server->theme);
-	theme_init(g_server->theme, g_server->renderer, rc.theme_name);
-
-	struct view *view;
-	wl_list_for_each (view, &g_server->views, link) {
-		if (!view->mapped || !view->ssd.enabled) {
-			continue;
-		}
-		view->margin = ssd_thickness(view);
-		struct ssd_part *part;
-		wl_list_for_each(part, &view->ssd.parts, link) {
-			part->box = ssd_box(view, part->type);
-		}
-	}
-
-	menu_reconfigure(g_server, g_server->rootmenu);
-
-	damage_all_outputs(g_server);
-}
-
 static int
 handle_sighup(int signal, void *data)
 {
-	reload_config_and_theme();
+	reload_config_and_theme(g_server);
 	return 0;
 }
 
@@ -201,6 +172,8 @@ server_init(struct server *server)
 		wlr_foreign_toplevel_manager_v1_create(server->wl_display);
 
 	layers_init(server);
+	idle_init(server);
+	reload_init(server);
 
 #if HAVE_XWAYLAND
 	/* Init xwayland */
@@ -283,10 +256,13 @@ server_finish(struct server *server)
 	if (sighup_source) {
 		wl_event_source_remove(sighup_source);
 	}
+	reload_finish(server);
+	idle_finish(server);
 	wl_display_destroy_clients(server->wl_display);
 
 	seat_finish(server);
 	wlr_output_layout_destroy(server->output_layout);
+	free(server->mapped_views);
 
 	wl_display_destroy(server->wl_display);
 }
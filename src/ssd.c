@@ -5,8 +5,10 @@
  */
 
 #include <assert.h>
+#include <string.h>
 #include "config/rcxml.h"
 #include "common/font.h"
+#include "common/timing.h"
 #include "labwc.h"
 #include "theme.h"
 #include "ssd.h"
@@ -147,10 +149,13 @@ ssd_box(struct view *view, enum ssd_part_type type)
 	case LAB_SSD_PART_TITLE:
 		box = ssd_box(view, LAB_SSD_PART_TITLEBAR);
 		if (view->title) {
+			int width, height;
+			font_texture_size(view->server, view->title, &width,
+				&height);
 			/* center align title vertically within allocated box */
-			box.y += (box.height - view->title->height) / 2;
-			box.width = view->title->width;
-			box.height = view->title->height;
+			box.y += (box.height - height) / 2;
+			box.width = width;
+			box.height = height;
 		}
 		break;
 	case LAB_SSD_PART_CORNER_TOP_LEFT:
@@ -195,14 +200,27 @@ ssd_box(struct view *view, enum ssd_part_type type)
 enum ssd_part_type
 ssd_at(struct view *view, double lx, double ly)
 {
+	uint64_t start = timing_begin();
 	enum ssd_part_type type;
 	for (type = 0; type < LAB_SSD_END_MARKER; ++type) {
 		struct wlr_box box = ssd_interactive_box(view, type);
 		if (wlr_box_contains_point(&box, lx, ly)) {
-			return type;
+			break;
 		}
 	}
-	return LAB_SSD_NONE;
+	if (type == LAB_SSD_END_MARKER) {
+		type = LAB_SSD_NONE;
+	}
+	timing_end("ssd_at", start);
+	return type;
+}
+
+bool
+ssd_is_button(enum ssd_part_type type)
+{
+	return type == LAB_SSD_BUTTON_CLOSE ||
+	       type == LAB_SSD_BUTTON_MAXIMIZE ||
+	       type == LAB_SSD_BUTTON_ICONIFY;
 }
 
 uint32_t
@@ -235,31 +253,42 @@ ssd_resize_edges(enum ssd_part_type type)
 static struct ssd_part *
 add_part(struct view *view, enum ssd_part_type type)
 {
-	struct ssd_part *part = calloc(1, sizeof(struct ssd_part));
+	assert(view->ssd.nr_parts < SSD_MAX_PARTS);
+	struct ssd_part *part = &view->ssd.parts[view->ssd.nr_parts++];
+	memset(part, 0, sizeof(*part));
 	part->type = type;
-	wl_list_insert(&view->ssd.parts, &part->link);
 	return part;
 }
 
+static void
+handle_title_ready(void *data)
+{
+	struct view *view = data;
+	for (int i = 0; i < view->ssd.nr_parts; i++) {
+		struct ssd_part *part = &view->ssd.parts[i];
+		if (part->type == LAB_SSD_PART_TITLE) {
+			part->box = ssd_box(view, part->type);
+			break;
+		}
+	}
+	damage_all_outputs(view->server);
+}
+
 void
 ssd_update_title(struct view *view)
 {
 	struct theme *theme = view->server->theme;
 
+	/*
+	 * The title is rasterized off the event loop; the previous title
+	 * stays on screen until handle_title_ready() is called.
+	 */
 	/* TODO: use window.active.label.text.color here */
 	/* TODO: set max_width propertly */
-	font_texture_create(view->server, &view->title, 200,
+	font_texture_create_async(view->server, &view->title, 200,
 		view->impl->get_string_prop(view, "title"),
 		rc.font_name_activewindow,
-		theme->menu_items_active_text_color);
-
-	struct ssd_part *part;
-	wl_list_for_each(part, &view->ssd.parts, link) {
-		if (part->type == LAB_SSD_PART_TITLE) {
-			part->box = ssd_box(view, part->type);
-			break;
-		}
-	}
+		theme->menu_items_active_text_color, handle_title_ready, view);
 }
 
 void
@@ -268,6 +297,8 @@ ssd_create(struct view *view)
 	struct theme *theme = view->server->theme;
 	struct ssd_part *part;
 
+	/* parts are stored inline, so re-creating on re-map just resets them */
+	view->ssd.nr_parts = 0;
 	view->ssd.box.x = view->x;
 	view->ssd.box.y = view->y;
 	view->ssd.box.width = view->w;
@@ -299,26 +330,29 @@ ssd_create(struct view *view)
 	part->texture.active = &view->title;
 	part->texture.inactive = &view->title;
 
+	/*
+	 * Corners have neither texture nor color as their images depend on
+	 * output scale. They are looked up with theme_assets_get() when
+	 * rendering.
+	 */
+
 	/* titlebar top-left corner */
 	part = add_part(view, LAB_SSD_PART_CORNER_TOP_LEFT);
 	part->box = ssd_box(view, part->type);
-	part->texture.active = &theme->corner_top_left_active_normal;
-	part->texture.inactive = &theme->corner_top_left_inactive_normal;
 
 	/* titlebar top-right corner */
 	part = add_part(view, LAB_SSD_PART_CORNER_TOP_RIGHT);
 	part->box = ssd_box(view, part->type);
-	part->texture.active = &theme->corner_top_right_active_normal;
-	part->texture.inactive = &theme->corner_top_right_inactive_normal;
 }
 
 void
 ssd_destroy(struct view *view)
 {
-	struct ssd_part *part, *next;
-	wl_list_for_each_safe(part, next, &view->ssd.parts, link) {
-		wl_list_remove(&part->link);
-		free(part);
+	view->ssd.nr_parts = 0;
+	font_texture_cancel(&view->title);
+	if (view->title) {
+		wlr_texture_destroy(view->title);
+		view->title = NULL;
 	}
 }
 
@@ -336,8 +370,8 @@ ssd_update_geometry(struct view *view)
 	if (!geometry_changed(view)) {
 		return;
 	}
-	struct ssd_part *part;
-	wl_list_for_each(part, &view->ssd.parts, link) {
+	for (int i = 0; i < view->ssd.nr_parts; i++) {
+		struct ssd_part *part = &view->ssd.parts[i];
 		part->box = ssd_box(view, part->type);
 	}
 	view->ssd.box.x = view->x;
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include "labwc.h"
+#include "layers.h"
+#include "stats.h"
+
+static uint32_t
+msec_between(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000 +
+		(end->tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void
+stats_begin(struct commit_stats *stats)
+{
+	if (!stats->since.tv_sec && !stats->since.tv_nsec) {
+		clock_gettime(CLOCK_MONOTONIC, &stats->since);
+	}
+}
+
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	uint64_t area = 0;
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	}
+	return area;
+}
+
+void
+stats_commit(struct commit_stats *stats, struct wlr_surface *surface)
+{
+	stats_begin(stats);
+	stats->commits++;
+
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_surface_get_effective_damage(surface, &damage);
+	stats->damage_area += region_area(&damage);
+	pixman_region32_fini(&damage);
+}
+
+void
+stats_configure_sent(struct commit_stats *stats, uint32_t serial)
+{
+	stats_begin(stats);
+	if (stats->configure_serial) {
+		/* still waiting for an earlier one - keep timing from that */
+		stats->configure_serial = serial;
+		return;
+	}
+	stats->configure_serial = serial;
+	clock_gettime(CLOCK_MONOTONIC, &stats->configure_sent);
+}
+
+void
+stats_configure_acked(struct commit_stats *stats, uint32_t serial)
+{
+	if (!stats->configure_serial || serial < stats->configure_serial) {
+		return;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint32_t latency = msec_between(&stats->configure_sent, &now);
+	stats->configure_serial = 0;
+	stats->configures_acked++;
+	stats->configure_latency_ms += latency;
+	if (latency > stats->configure_latency_max_ms) {
+		stats->configure_latency_max_ms = latency;
+	}
+}
+
+void
+stats_title_changed(struct commit_stats *stats)
+{
+	stats_begin(stats);
+	stats->title_changes++;
+}
+
+static void
+print_stats(const char *kind, const char *name, struct commit_stats *stats,
+		struct timespec *now)
+{
+	if (!stats->since.tv_sec && !stats->since.tv_nsec) {
+		return;
+	}
+	double secs = msec_between(&stats->since, now) / 1000.0;
+	if (secs < 0.001) {
+		secs = 0.001;
+	}
+	uint32_t latency_avg = stats->configures_acked ?
+		stats->configure_latency_ms / stats->configures_acked : 0;
+	printf("[%s] %s: commits/s=%.1f damage/s=%.0f title-changes/s=%.1f "
+		"configure-latency-ms(avg/max)=%u/%u\n", kind, name ? name : "",
+		stats->commits / secs, stats->damage_area / secs,
+		stats->title_changes / secs, latency_avg,
+		stats->configure_latency_max_ms);
+
+	/* reset, but keep any configure round-trip in flight */
+	uint32_t serial = stats->configure_serial;
+	struct timespec sent = stats->configure_sent;
+	memset(stats, 0, sizeof(*stats));
+	stats->since = *now;
+	stats->configure_serial = serial;
+	stats->configure_sent = sent;
+}
+
+void
+stats_dump(struct server *server)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		switch (view->type) {
+		case LAB_XDG_SHELL_VIEW:
+			print_stats("xdg-shell",
+				view->impl->get_string_prop(view, "app_id"),
+				&view->stats, &now);
+			break;
+#if HAVE_XWAYLAND
+		case LAB_XWAYLAND_VIEW:
+			print_stats("xwayland",
+				view->impl->get_string_prop(view, "class"),
+				&view->stats, &now);
+			break;
+#endif
+		}
+	}
+
+#if HAVE_XWAYLAND
+	struct xwayland_unmanaged *unmanaged;
+	wl_list_for_each (unmanaged, &server->unmanaged_surfaces, link) {
+		print_stats("xwayland-unmanaged",
+			unmanaged->xwayland_surface->class, &unmanaged->stats,
+			&now);
+	}
+#endif
+
+	struct output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		for (int i = 0; i < 4; i++) {
+			struct lab_layer_surface *layer;
+			wl_list_for_each (layer, &output->layers[i], link) {
+				print_stats("layer-shell",
+					layer->layer_surface->namespace,
+					&layer->stats, &now);
+			}
+		}
+	}
+	fflush(stdout);
+}
@@ -28,6 +28,7 @@ subsurface_create(struct view *view, struct wlr_subsurface *wlr_subsurface)
 	}
 	view_child_init(&subsurface->view_child, view, wlr_subsurface->surface);
 	subsurface->subsurface = wlr_subsurface;
+	view_surface_enter_outputs(view, wlr_subsurface->surface);
 
 	subsurface->destroy.notify = subsurface_handle_destroy;
 	wl_signal_add(&wlr_subsurface->events.destroy, &subsurface->destroy);
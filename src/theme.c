@@ -18,6 +18,7 @@
 #include <wlr/util/log.h>
 #include "common/dir.h"
 #include "common/font.h"
+#include "common/hash.h"
 #include "common/string-helpers.h"
 #include "common/zfree.h"
 #include "config/rcxml.h"
@@ -90,6 +91,14 @@ theme_builtin(struct theme *theme)
 	parse_hexstr("#000000", theme->window_inactive_button_iconify_unpressed_image_color);
 	parse_hexstr("#000000", theme->window_inactive_button_max_unpressed_image_color);
 	parse_hexstr("#000000", theme->window_inactive_button_close_unpressed_image_color);
+	parse_hexstr("#000000", theme->window_active_button_hover_image_color);
+	parse_hexstr("#000000", theme->window_active_button_pressed_image_color);
+	parse_hexstr("#000000", theme->window_inactive_button_hover_image_color);
+	parse_hexstr("#000000", theme->window_inactive_button_pressed_image_color);
+	theme->window_active_button_hover_set = false;
+	theme->window_active_button_pressed_set = false;
+	theme->window_inactive_button_hover_set = false;
+	theme->window_inactive_button_pressed_set = false;
 
 	parse_hexstr("#fcfbfa", theme->menu_items_bg_color);
 	parse_hexstr("#000000", theme->menu_items_text_color);
@@ -147,6 +156,23 @@ entry(struct theme *theme, const char *key, const char *value)
 		parse_hexstr(value, theme->window_inactive_button_close_unpressed_image_color);
 	}
 
+	if (match(key, "window.active.button.hover.image.color")) {
+		parse_hexstr(value, theme->window_active_button_hover_image_color);
+		theme->window_active_button_hover_set = true;
+	}
+	if (match(key, "window.active.button.pressed.image.color")) {
+		parse_hexstr(value, theme->window_active_button_pressed_image_color);
+		theme->window_active_button_pressed_set = true;
+	}
+	if (match(key, "window.inactive.button.hover.image.color")) {
+		parse_hexstr(value, theme->window_inactive_button_hover_image_color);
+		theme->window_inactive_button_hover_set = true;
+	}
+	if (match(key, "window.inactive.button.pressed.image.color")) {
+		parse_hexstr(value, theme->window_inactive_button_pressed_image_color);
+		theme->window_inactive_button_pressed_set = true;
+	}
+
 	/* individual buttons */
 	if (match(key, "window.active.button.iconify.unpressed.image.color")) {
 		parse_hexstr(value, theme->window_active_button_iconify_unpressed_image_color);
@@ -254,23 +280,28 @@ set_source(cairo_t *cairo, float *c)
 	cairo_set_source_rgba(cairo, c[0], c[1], c[2], c[3]);
 }
 
-static struct wlr_texture *
-rounded_rect(struct wlr_renderer *renderer, struct rounded_corner_ctx *ctx)
+static void
+rounded_rect(struct atlas *atlas, struct atlas_region *region,
+		struct rounded_corner_ctx *ctx, float scale)
 {
 	/* 1 degree in radians (=2π/360) */
 	double deg = 0.017453292519943295;
 
 	if (ctx->corner == LAB_CORNER_UNKNOWN) {
-		return NULL;
+		return;
 	}
 
 	double w = ctx->box->width;
 	double h = ctx->box->height;
 	double r = ctx->radius;
 
+	/* draw in layout coordinates, but at output resolution */
+	int width = ceil(w * scale);
+	int height = ceil(h * scale);
 	cairo_surface_t *surf =
-		cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+		cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
 	cairo_t *cairo = cairo_create(surf);
+	cairo_scale(cairo, scale, scale);
 
 	/* set transparent background */
 	cairo_set_operator(cairo, CAIRO_OPERATOR_CLEAR);
@@ -324,20 +355,19 @@ rounded_rect(struct wlr_renderer *renderer, struct rounded_corner_ctx *ctx)
 	}
 	cairo_stroke(cairo);
 
-	/* convert to wlr_texture */
+	/* copy to atlas */
 	cairo_surface_flush(surf);
 	unsigned char *data = cairo_image_surface_get_data(surf);
-	struct wlr_texture *texture = wlr_texture_from_pixels(renderer,
-		DRM_FORMAT_ARGB8888, cairo_image_surface_get_stride(surf),
-		w, h, data);
+	atlas_add(atlas, region, (uint32_t *)data, width, height,
+		cairo_image_surface_get_stride(surf));
 
 	cairo_destroy(cairo);
 	cairo_surface_destroy(surf);
-	return texture;
 }
 
 static void
-create_corners(struct theme *theme, struct wlr_renderer *renderer)
+create_corners(struct theme *theme, struct theme_assets *assets,
+		struct atlas *atlas)
 {
 	int corner_square = theme->title_height + theme->border_width;
 	struct wlr_box box = {
@@ -349,45 +379,100 @@ create_corners(struct theme *theme, struct wlr_renderer *renderer)
 
 	struct rounded_corner_ctx ctx = {
 		.box = &box,
-		.radius = rc.corner_radius,
+		.radius = theme->corner_radius,
 		.line_width = theme->border_width,
 		.fill_color = theme->window_active_title_bg_color,
 		.border_color = theme->window_active_border_color,
 		.corner = LAB_CORNER_TOP_LEFT,
 	};
-	theme->corner_top_left_active_normal = rounded_rect(renderer, &ctx);
+	rounded_rect(atlas, &assets->corner_top_left_active_normal, &ctx,
+		assets->scale);
 
 	ctx.fill_color = theme->window_inactive_title_bg_color,
 	ctx.border_color = theme->window_inactive_border_color,
-	theme->corner_top_left_inactive_normal = rounded_rect(renderer, &ctx);
+	rounded_rect(atlas, &assets->corner_top_left_inactive_normal, &ctx,
+		assets->scale);
 
 	ctx.corner = LAB_CORNER_TOP_RIGHT;
 	ctx.fill_color = theme->window_active_title_bg_color,
 	ctx.border_color = theme->window_active_border_color,
-	theme->corner_top_right_active_normal = rounded_rect(renderer, &ctx);
+	rounded_rect(atlas, &assets->corner_top_right_active_normal, &ctx,
+		assets->scale);
 
 	ctx.fill_color = theme->window_inactive_title_bg_color,
 	ctx.border_color = theme->window_inactive_border_color,
-	theme->corner_top_right_inactive_normal = rounded_rect(renderer, &ctx);
+	rounded_rect(atlas, &assets->corner_top_right_inactive_normal, &ctx,
+		assets->scale);
 }
 
 static void
-post_processing(struct theme *theme)
+post_processing(struct theme *theme, struct rcxml *config)
 {
 	char buf[256];
-	snprintf(buf, sizeof(buf), "%s %d", rc.font_name_activewindow,
-		 rc.font_size_activewindow);
+	snprintf(buf, sizeof(buf), "%s %d", config->font_name_activewindow,
+		 config->font_size_activewindow);
 	theme->title_height = font_height(buf) + 2 * theme->padding_height;
 
-	if (rc.corner_radius >= theme->title_height) {
-		theme->title_height = rc.corner_radius + 1;
+	theme->corner_radius = config->corner_radius;
+	if (theme->corner_radius >= theme->title_height) {
+		theme->title_height = theme->corner_radius + 1;
 	}
 
+	/*
+	 * Like Openbox, use the unpressed color for hover and pressed unless
+	 * set. They are shared by all buttons, so take that of close, which
+	 * the universal window.*.button.unpressed.image.color also sets.
+	 */
+	size_t size = sizeof(float) * 4;
+	if (!theme->window_active_button_hover_set) {
+		memcpy(theme->window_active_button_hover_image_color,
+			theme->window_active_button_close_unpressed_image_color, size);
+	}
+	if (!theme->window_active_button_pressed_set) {
+		memcpy(theme->window_active_button_pressed_image_color,
+			theme->window_active_button_close_unpressed_image_color, size);
+	}
+	if (!theme->window_inactive_button_hover_set) {
+		memcpy(theme->window_inactive_button_hover_image_color,
+			theme->window_inactive_button_close_unpressed_image_color, size);
+	}
+	if (!theme->window_inactive_button_pressed_set) {
+		memcpy(theme->window_inactive_button_pressed_image_color,
+			theme->window_inactive_button_close_unpressed_image_color, size);
+	}
+}
+
+static struct theme_assets *
+assets_create(struct theme *theme, float scale)
+{
+	struct theme_assets *assets = calloc(1, sizeof(*assets));
+	if (!assets) {
+		wlr_log(WLR_ERROR, "cannot allocate theme images");
+		return NULL;
+	}
+	assets->scale = scale;
+	assets->pending = atlas_create();
+	create_corners(theme, assets, assets->pending);
+	xbm_load(theme, assets, assets->pending);
+	wl_list_insert(&theme->assets, &assets->link);
+	return assets;
+}
+
+static struct theme_assets *
+assets_find(struct theme *theme, float scale)
+{
+	struct theme_assets *assets;
+	wl_list_for_each (assets, &theme->assets, link) {
+		if (assets->scale == scale) {
+			return assets;
+		}
+	}
+	return NULL;
 }
 
 void
-theme_init(struct theme *theme, struct wlr_renderer *renderer,
-		const char *theme_name)
+theme_load(struct theme *theme, struct rcxml *config, float *scales,
+		int nr_scales)
 {
 	/*
 	 * Set some default values. This is particularly important on
@@ -395,14 +480,107 @@ theme_init(struct theme *theme, struct wlr_renderer *renderer,
 	 */
 	theme_builtin(theme);
 
-	theme_read(theme, theme_name);
-	post_processing(theme);
-	create_corners(theme, renderer);
-	xbm_load(theme, renderer);
+	theme->name = config->theme_name ? strdup(config->theme_name) : NULL;
+	theme_read(theme, theme->name);
+	post_processing(theme, config);
+
+	wl_list_init(&theme->assets);
+	for (int i = 0; i < nr_scales; i++) {
+		assets_create(theme, scales[i]);
+	}
+}
+
+uint64_t
+theme_hash(struct rcxml *config)
+{
+	uint64_t hash = HASH_INIT;
+	hash = hash_str(hash, config->theme_name);
+	hash = hash_str(hash, config->font_name_activewindow);
+	hash = hash_int(hash, config->font_size_activewindow);
+	hash = hash_int(hash, config->corner_radius);
+
+	char themerc[4096];
+	snprintf(themerc, sizeof(themerc), "%s/themerc",
+		theme_dir(config->theme_name));
+	hash = hash_file(hash, themerc);
+	return xbm_hash(hash, config->theme_name);
+}
+
+void
+theme_init(struct theme *theme, struct wlr_renderer *renderer)
+{
+	theme_load(theme, &rc, NULL, 0);
+	theme->renderer = renderer;
+}
+
+struct theme_assets *
+theme_assets_get(struct theme *theme, float scale)
+{
+	struct theme_assets *assets = assets_find(theme, scale);
+	if (assets && assets->pending) {
+		assets->atlas = atlas_finish(assets->pending, theme->renderer);
+		assets->pending = NULL;
+	}
+	return assets;
+}
+
+static void
+assets_destroy(struct theme_assets *assets)
+{
+	if (assets->atlas) {
+		wlr_texture_destroy(assets->atlas);
+	}
+	atlas_destroy(assets->pending);
+	wl_list_remove(&assets->link);
+	free(assets);
+}
+
+void
+theme_assets_update(struct theme *theme, float *scales, int nr_scales)
+{
+	struct theme_assets *assets, *next;
+	wl_list_for_each_safe (assets, next, &theme->assets, link) {
+		bool in_use = false;
+		for (int i = 0; i < nr_scales; i++) {
+			if (scales[i] == assets->scale) {
+				in_use = true;
+				break;
+			}
+		}
+		if (!in_use) {
+			assets_destroy(assets);
+		}
+	}
+	for (int i = 0; i < nr_scales; i++) {
+		if (!assets_find(theme, scales[i])
+				&& assets_create(theme, scales[i])) {
+			wlr_log(WLR_DEBUG, "created theme images for scale "
+				"%.2f", scales[i]);
+		}
+	}
 }
 
 void
 theme_finish(struct theme *theme)
 {
-	; /* nothing to free */
+	struct theme_assets *assets, *next;
+	wl_list_for_each_safe (assets, next, &theme->assets, link) {
+		assets_destroy(assets);
+	}
+	zfree(theme->name);
+}
+
+void
+theme_replace(struct theme *theme, struct theme *new)
+{
+	struct wlr_renderer *renderer = theme->renderer;
+	theme_finish(theme);
+	*theme = *new;
+	theme->renderer = renderer;
+
+	/* the list head has moved, so re-link the assets */
+	wl_list_init(&theme->assets);
+	wl_list_insert_list(&theme->assets, &new->assets);
+	wl_list_init(&new->assets);
+	new->name = NULL;
 }
@@ -0,0 +1,225 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/util/log.h>
+#include "labwc.h"
+#include "trace.h"
+
+#define TRACE_MAGIC "LABWCTR1"
+#define TRACE_MAGIC_LEN (8)
+
+struct trace_record {
+	uint32_t msec;
+	uint32_t type;
+	int32_t args[3];
+};
+
+static struct {
+	FILE *stream;
+	struct timespec start;
+	uint32_t next_view_id;
+} rec;
+
+static struct {
+	struct server *server;
+	struct wl_event_source *timer;
+	struct trace_record *records;
+	size_t nr_records;
+	size_t pos;
+	struct timespec start;
+} replay;
+
+static uint32_t
+msec_since(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+		(now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+void
+trace_record_init(const char *filename)
+{
+	rec.stream = fopen(filename, "wb");
+	if (!rec.stream) {
+		wlr_log(WLR_ERROR, "cannot create trace file (%s)", filename);
+		return;
+	}
+	fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_LEN, rec.stream);
+	clock_gettime(CLOCK_MONOTONIC, &rec.start);
+	wlr_log(WLR_INFO, "record trace to %s", filename);
+}
+
+static void
+record(enum trace_type type, int32_t a, int32_t b, int32_t c)
+{
+	struct trace_record r = {
+		.msec = msec_since(&rec.start),
+		.type = type,
+		.args = { a, b, c },
+	};
+	fwrite(&r, sizeof(r), 1, rec.stream);
+}
+
+void
+trace_input(enum trace_type type, int32_t a, int32_t b, int32_t c)
+{
+	if (!rec.stream) {
+		return;
+	}
+	record(type, a, b, c);
+}
+
+void
+trace_view(struct view *view, enum trace_type type, int32_t a, int32_t b)
+{
+	if (!rec.stream) {
+		return;
+	}
+	if (!view->trace_id) {
+		view->trace_id = ++rec.next_view_id;
+	}
+	record(type, view->trace_id, a, b);
+}
+
+static void
+replay_record(struct trace_record *r)
+{
+	struct server *server = replay.server;
+	struct seat *seat = &server->seat;
+
+	switch (r->type) {
+	case TRACE_CURSOR_MOTION:
+		wlr_cursor_warp_closest(seat->cursor, NULL,
+			wl_fixed_to_double(r->args[0]),
+			wl_fixed_to_double(r->args[1]));
+		process_cursor_motion(server, r->msec);
+		break;
+	case TRACE_CURSOR_BUTTON: {
+		struct wlr_event_pointer_button event = {
+			.time_msec = r->msec,
+			.button = r->args[0],
+			.state = r->args[1],
+		};
+		seat->cursor_button.notify(&seat->cursor_button, &event);
+		break;
+	}
+	case TRACE_CURSOR_AXIS: {
+		struct wlr_event_pointer_axis event = {
+			.time_msec = r->msec,
+			.source = r->args[0] >> 16,
+			.orientation = r->args[0] & 0xffff,
+			.delta = wl_fixed_to_double(r->args[1]),
+			.delta_discrete = r->args[2],
+		};
+		seat->cursor_axis.notify(&seat->cursor_axis, &event);
+		break;
+	}
+	case TRACE_CURSOR_FRAME:
+		seat->cursor_frame.notify(&seat->cursor_frame, NULL);
+		break;
+	case TRACE_KEY: {
+		/* go via the keyboard so that xkb state is kept up-to-date */
+		struct wlr_event_keyboard_key event = {
+			.time_msec = r->msec,
+			.keycode = r->args[0],
+			.update_state = true,
+			.state = r->args[1],
+		};
+		wlr_keyboard_notify_key(&seat->keyboard_group->keyboard, &event);
+		break;
+	}
+	default:
+		/* client events cannot be replayed without the client */
+		break;
+	}
+}
+
+static int
+handle_replay_timer(void *data)
+{
+	uint32_t now = msec_since(&replay.start);
+	while (replay.pos < replay.nr_records) {
+		struct trace_record *r = &replay.records[replay.pos];
+		if (r->msec > now) {
+			wl_event_source_timer_update(replay.timer, r->msec - now);
+			return 0;
+		}
+		replay_record(r);
+		replay.pos++;
+	}
+	wlr_log(WLR_INFO, "replayed %zu trace events", replay.nr_records);
+	wl_display_terminate(replay.server->wl_display);
+	return 0;
+}
+
+void
+trace_replay(struct server *server, const char *filename)
+{
+	FILE *stream = fopen(filename, "rb");
+	if (!stream) {
+		wlr_log(WLR_ERROR, "cannot read trace file (%s)", filename);
+		return;
+	}
+	char magic[TRACE_MAGIC_LEN];
+	if (fread(magic, 1, TRACE_MAGIC_LEN, stream) != TRACE_MAGIC_LEN ||
+			memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN)) {
+		wlr_log(WLR_ERROR, "not a labwc trace file (%s)", filename);
+		fclose(stream);
+		return;
+	}
+
+	size_t alloc = 0;
+	struct trace_record r;
+	while (fread(&r, sizeof(r), 1, stream) == 1) {
+		if (replay.nr_records == alloc) {
+			alloc = (alloc + 16) * 2;
+			struct trace_record *records = realloc(replay.records,
+				alloc * sizeof(struct trace_record));
+			if (!records) {
+				wlr_log(WLR_ERROR, "cannot allocate trace records");
+				free(replay.records);
+				replay.records = NULL;
+				replay.nr_records = 0;
+				fclose(stream);
+				return;
+			}
+			replay.records = records;
+		}
+		replay.records[replay.nr_records++] = r;
+	}
+	fclose(stream);
+	wlr_log(WLR_INFO, "replay %zu trace events from %s",
+		replay.nr_records, filename);
+
+	/* The headless backend has no input devices, so pretend we do */
+	wlr_seat_set_capabilities(server->seat.seat,
+		WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_KEYBOARD);
+
+	replay.server = server;
+	struct wl_event_loop *event_loop =
+		wl_display_get_event_loop(server->wl_display);
+	replay.timer = wl_event_loop_add_timer(event_loop, handle_replay_timer,
+		NULL);
+	clock_gettime(CLOCK_MONOTONIC, &replay.start);
+	wl_event_source_timer_update(replay.timer, 1);
+}
+
+void
+trace_finish(void)
+{
+	if (rec.stream) {
+		fclose(rec.stream);
+		rec.stream = NULL;
+	}
+	if (replay.timer) {
+		wl_event_source_remove(replay.timer);
+		replay.timer = NULL;
+	}
+	free(replay.records);
+	replay.records = NULL;
+}
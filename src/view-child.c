@@ -3,13 +3,81 @@
  * This file is only needed in support of tracking damage
  */
 
+#include <string.h>
 #include "labwc.h"
 
+/* position of the child surface relative to the view's surface */
+static void
+view_child_coords(struct view_child *child, int *sx, int *sy)
+{
+	struct wlr_surface *surface = child->surface;
+	*sx = *sy = 0;
+	while (wlr_surface_is_subsurface(surface)) {
+		struct wlr_subsurface *subsurface =
+			wlr_subsurface_from_wlr_surface(surface);
+		if (!subsurface || !subsurface->parent) {
+			return;
+		}
+		*sx += subsurface->current.x;
+		*sy += subsurface->current.y;
+		surface = subsurface->parent;
+	}
+	if (!wlr_surface_is_xdg_surface(surface)) {
+		return;
+	}
+	struct wlr_xdg_surface *xdg_surface =
+		wlr_xdg_surface_from_wlr_surface(surface);
+	if (!xdg_surface || xdg_surface->role != WLR_XDG_SURFACE_ROLE_POPUP) {
+		return;
+	}
+	struct wlr_xdg_popup *popup = xdg_surface->popup;
+	int popup_sx, popup_sy;
+	wlr_xdg_popup_get_toplevel_coords(popup,
+		popup->geometry.x - xdg_surface->geometry.x,
+		popup->geometry.y - xdg_surface->geometry.y,
+		&popup_sx, &popup_sy);
+	*sx += popup_sx;
+	*sy += popup_sy;
+}
+
+void
+view_child_damage(struct view_child *child, bool whole)
+{
+	struct view *view = child->parent;
+	int sx, sy;
+	view_child_coords(child, &sx, &sy);
+	struct wlr_box box = {
+		.x = view->x + sx,
+		.y = view->y + sy,
+		.width = child->surface->current.width,
+		.height = child->surface->current.height,
+	};
+	if (memcmp(&box, &child->damaged, sizeof(box))) {
+		/* moved, resized or lost its buffer, so damage what it covered */
+		damage_box(view->server, &child->damaged);
+		child->damaged = box;
+		whole = true;
+	}
+	struct output *output;
+	wl_list_for_each (output, &view->server->outputs, link) {
+		output_damage_surface(output, child->surface, box.x, box.y,
+			whole);
+	}
+}
+
+void
+view_child_damage_unmap(struct view_child *child)
+{
+	damage_box(child->parent->server, &child->damaged);
+	child->damaged = (struct wlr_box){0};
+}
+
 static void
 view_child_handle_commit(struct wl_listener *listener, void *data)
 {
 	struct view_child *child = wl_container_of(listener, child, commit);
-	damage_all_outputs(child->parent->server);
+	view_update_regions(child->parent);
+	view_child_damage(child, false);
 }
 
 static void
@@ -34,6 +102,7 @@ view_child_init(struct view_child *child, struct view *view,
 {
 	child->parent = view;
 	child->surface = wlr_surface;
+	child->damaged = (struct wlr_box){0};
 	child->commit.notify = view_child_handle_commit;
 	wl_signal_add(&wlr_surface->events.commit, &child->commit);
 	child->new_subsurface.notify = view_child_handle_new_subsurface;
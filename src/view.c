@@ -13,6 +13,8 @@ void
 view_move(struct view *view, double x, double y)
 {
 	view->impl->move(view, x, y);
+	view_update_regions(view);
+	view_update_outputs(view);
 }
 
 void
@@ -26,6 +28,9 @@ view_minimize(struct view *view, bool minimized)
 			minimized);
 	}
 	view->minimized = minimized;
+	if (view->impl->minimize) {
+		view->impl->minimize(view, minimized);
+	}
 	if (minimized) {
 		view->impl->unmap(view);
 	} else {
@@ -64,6 +69,21 @@ view_center(struct view *view)
 	view_move(view, center_x - view->w / 2, center_y - view->h / 2);
 }
 
+/* geometry of a maximized view, filling the usable area of its output */
+static struct wlr_box
+view_maximized_geometry(struct view *view, struct output *output)
+{
+	struct wlr_box box = output_usable_area_in_layout_coords(output);
+	if (view->ssd.enabled) {
+		struct border border = ssd_thickness(view);
+		box.x += border.left;
+		box.y += border.top;
+		box.width -= border.right + border.left;
+		box.height -= border.top + border.bottom;
+	}
+	return box;
+}
+
 void
 view_maximize(struct view *view, bool maximize)
 {
@@ -82,16 +102,7 @@ view_maximize(struct view *view, bool maximize)
 		view->unmaximized_geometry.height = view->h;
 
 		struct output *output = view_output(view);
-		struct wlr_box box = output_usable_area_in_layout_coords(output);
-
-		if (view->ssd.enabled) {
-			struct border border = ssd_thickness(view);
-			box.x += border.left;
-			box.y += border.top;
-			box.width -= border.right + border.left;
-			box.height -= border.top + border.bottom;
-		}
-		view_move_resize(view, box);
+		view_move_resize(view, view_maximized_geometry(view, output));
 		view->maximized = true;
 	} else {
 		/* unmaximize */
@@ -106,6 +117,30 @@ view_toggle_maximize(struct view *view)
 	view_maximize(view, !view->maximized);
 }
 
+void
+view_arrange_maximized(struct output *output)
+{
+	struct server *server = output->server;
+	int nr_configured = 0;
+	struct view *view;
+	wl_list_for_each (view, &server->views, link) {
+		if (!view->maximized || view_output(view) != output) {
+			continue;
+		}
+		struct wlr_box box = view_maximized_geometry(view, output);
+		if (box.x == view->x && box.y == view->y
+				&& box.width == view->w && box.height == view->h) {
+			continue;
+		}
+		view->impl->configure(view, box);
+		++nr_configured;
+	}
+	if (nr_configured) {
+		wlr_log(WLR_DEBUG, "re-arranged %d maximized views on %s",
+			nr_configured, output->wlr_output->name);
+	}
+}
+
 void
 view_for_each_surface(struct view *view, wlr_surface_iterator_func_t iterator,
 		void *user_data)
@@ -164,6 +199,131 @@ view_move_to_edge(struct view *view, const char *direction)
 	view_move(view, x, y);
 }
 
+struct view_region_data {
+	pixman_region32_t *region;
+	int x, y;
+};
+
+static void
+view_region_iterator(struct wlr_surface *surface, int sx, int sy,
+		void *user_data)
+{
+	struct view_region_data *data = user_data;
+	pixman_region32_union_rect(data->region, data->region,
+		data->x + sx, data->y + sy, surface->current.width,
+		surface->current.height);
+}
+
+void
+view_update_regions(struct view *view)
+{
+	pixman_region32_clear(&view->extents);
+	pixman_region32_clear(&view->opaque);
+	if (!view->mapped || !view->surface) {
+		return;
+	}
+	struct view_region_data data = {
+		.region = &view->extents,
+		.x = view->x,
+		.y = view->y,
+	};
+	view_for_each_surface(view, view_region_iterator, &data);
+	if (view->ssd.enabled) {
+		struct wlr_box box = ssd_max_extents(view);
+		pixman_region32_union_rect(&view->extents, &view->extents,
+			box.x, box.y, box.width, box.height);
+	}
+	pixman_region32_copy(&view->opaque, &view->surface->opaque_region);
+	pixman_region32_translate(&view->opaque, view->x, view->y);
+}
+
+struct surface_output_data {
+	struct wlr_output *wlr_output;
+	bool enter;
+};
+
+static void
+surface_output_iterator(struct wlr_surface *surface, int sx, int sy,
+		void *user_data)
+{
+	struct surface_output_data *data = user_data;
+	if (data->enter) {
+		wlr_surface_send_enter(surface, data->wlr_output);
+	} else {
+		wlr_surface_send_leave(surface, data->wlr_output);
+	}
+}
+
+void
+view_update_outputs(struct view *view)
+{
+	struct server *server = view->server;
+	uint32_t outputs = 0;
+	struct output *output;
+	if (view->mapped && view->surface) {
+		/* decorations count, as their damage is only sent to these */
+		struct wlr_box box = {
+			.x = view->x,
+			.y = view->y,
+			.width = view->w + view->padding.left + view->padding.right,
+			.height = view->h + view->padding.top + view->padding.bottom,
+		};
+		if (view->ssd.enabled) {
+			box = ssd_max_extents(view);
+		}
+		/*
+		 * Disabled outputs are removed from the layout, except when
+		 * powered off while idle, which should not change membership
+		 */
+		wl_list_for_each (output, &server->outputs, link) {
+			if (wlr_output_layout_intersects(server->output_layout,
+					output->wlr_output, &box)) {
+				outputs |= output->bit;
+			}
+		}
+	}
+	if (outputs == view->outputs) {
+		return;
+	}
+	wl_list_for_each (output, &server->outputs, link) {
+		bool was_on = view->outputs & output->bit;
+		bool is_on = outputs & output->bit;
+		if (was_on == is_on || !view->surface) {
+			continue;
+		}
+		struct surface_output_data data = {
+			.wlr_output = output->wlr_output,
+			.enter = is_on,
+		};
+		view_for_each_surface(view, surface_output_iterator, &data);
+	}
+	view->outputs = outputs;
+}
+
+void
+view_surface_enter_outputs(struct view *view, struct wlr_surface *surface)
+{
+	struct output *output;
+	wl_list_for_each (output, &view->server->outputs, link) {
+		if (!(view->outputs & output->bit)) {
+			continue;
+		}
+		struct surface_output_data data = {
+			.wlr_output = output->wlr_output,
+			.enter = true,
+		};
+		wlr_surface_for_each_surface(surface, surface_output_iterator,
+			&data);
+	}
+}
+
+bool
+view_on_output(struct view *view, struct output *output)
+{
+	/* without a bit, membership is unknown */
+	return !output->bit || (view->outputs & output->bit);
+}
+
 void
 view_update_title(struct view *view)
 {
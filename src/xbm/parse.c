@@ -14,7 +14,7 @@
 
 #include "xbm/parse.h"
 
-static uint32_t color;
+static _Thread_local uint32_t color;
 
 static uint32_t
 u32(float *rgba)
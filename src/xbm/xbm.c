@@ -1,108 +1,163 @@
 /*
- * Create wlr textures based on xbm data
+ * Create theme button images from xbm data
  *
  * Copyright Johan Malm 2020
  */
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <drm_fourcc.h>
 
+#include "common/atlas.h"
 #include "common/dir.h"
 #include "common/grab-file.h"
-#include "config/rcxml.h"
+#include "common/hash.h"
+#include "common/timing.h"
 #include "theme.h"
 #include "xbm/parse.h"
 #include "xbm/xbm.h"
 
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
 /* built-in 6x6 buttons */
 char close_button_normal[] = { 0x33, 0x3f, 0x1e, 0x1e, 0x3f, 0x33 };
 char iconify_button_normal[] = { 0x00, 0x00, 0x00, 0x00, 0x3f, 0x3f };
 char max_button_normal[] = { 0x3f, 0x3f, 0x21, 0x21, 0x21, 0x3f };
 char max_button_toggled[] = { 0x3e, 0x22, 0x2f, 0x29, 0x39, 0x0f };
 
-static struct wlr_texture *
-texture_from_pixmap(struct wlr_renderer *renderer, struct pixmap *pixmap)
+static char *
+xbm_path(struct theme *theme, const char *button)
 {
-	if (!pixmap) {
-		return NULL;
-	}
-	return wlr_texture_from_pixels(renderer, DRM_FORMAT_ARGB8888,
-				       pixmap->width * 4, pixmap->width,
-				       pixmap->height, pixmap->data);
+	static _Thread_local char buffer[4096] = { 0 };
+	snprintf(buffer, sizeof(buffer), "%s/%s", theme_dir(theme->name),
+		 button);
+	return buffer;
 }
 
-static struct wlr_texture *
-texture_from_builtin(struct wlr_renderer *renderer, const char *button)
+static struct pixmap
+parse_button(struct token *tokens, char *button)
 {
-	struct pixmap pixmap = parse_xbm_builtin(button, 6);
-	struct wlr_texture *texture = texture_from_pixmap(renderer, &pixmap);
-	if (pixmap.data) {
-		free(pixmap.data);
+	struct pixmap pixmap = { 0 };
+	if (tokens) {
+		uint64_t start = timing_begin();
+		pixmap = parse_xbm_tokens(tokens);
+		timing_end("parse_xbm_tokens", start);
+	}
+	if (!pixmap.data) {
+		pixmap = parse_xbm_builtin(button, 6);
 	}
-	return texture;
+	return pixmap;
 }
 
-static char *
-xbm_path(const char *button)
+/*
+ * Scale with nearest-neighbour sampling so that bitmap icons stay sharp
+ * rather than being blurred by the GPU on scaled outputs
+ */
+static struct pixmap
+pixmap_scale(struct pixmap *src, float scale)
 {
-	static char buffer[4096] = { 0 };
-	snprintf(buffer, sizeof(buffer), "%s/%s", theme_dir(rc.theme_name),
-		 button);
-	return buffer;
+	if (scale == 1.0f || !src->data) {
+		return *src;
+	}
+	struct pixmap dst = {
+		.width = round(src->width * scale),
+		.height = round(src->height * scale),
+	};
+	dst.data = calloc(dst.width * dst.height, sizeof(uint32_t));
+	for (int row = 0; row < dst.height; row++) {
+		int src_row = MIN((int)(row / scale), src->height - 1);
+		for (int col = 0; col < dst.width; col++) {
+			int src_col = MIN((int)(col / scale), src->width - 1);
+			dst.data[row * dst.width + col] =
+				src->data[src_row * src->width + src_col];
+		}
+	}
+	free(src->data);
+	return dst;
 }
 
+/*
+ * Add one image per button state to the atlas. The file is only read and
+ * tokenized once and then parsed with the color of each state.
+ * @colors: image colors indexed by enum button_state
+ */
 static void
-load_button(struct wlr_renderer *renderer, const char *filename,
-	    struct wlr_texture **texture, char *button)
+load_button(struct theme *theme, struct atlas *atlas, float scale,
+		const char *filename, char *button, float *colors[],
+		struct atlas_region *regions)
 {
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
-	}
+	struct token *tokens = NULL;
 
 	/* Read file into memory as it's easier to tokenzie that way */
-	char *buffer = grab_file(xbm_path(filename));
-	if (!buffer) {
-		goto out;
+	char *buffer = grab_file(xbm_path(theme, filename));
+	if (buffer) {
+		uint64_t start = timing_begin();
+		tokens = tokenize_xbm(buffer);
+		timing_end("tokenize_xbm", start);
+		free(buffer);
 	}
-	struct token *tokens = tokenize_xbm(buffer);
-	free(buffer);
 
-	struct pixmap pixmap = parse_xbm_tokens(tokens);
-	*texture = texture_from_pixmap(renderer, &pixmap);
-	if (tokens) {
-		free(tokens);
-	}
-	if (pixmap.data) {
+	for (int i = 0; i < LAB_BUTTON_STATE_COUNT; i++) {
+		parse_set_color(colors[i]);
+		struct pixmap pixmap = parse_button(tokens, button);
+		pixmap = pixmap_scale(&pixmap, scale);
+		atlas_add(atlas, &regions[i], pixmap.data, pixmap.width,
+			pixmap.height, pixmap.width * sizeof(uint32_t));
 		free(pixmap.data);
 	}
-out:
-	if (!(*texture)) {
-		*texture = texture_from_builtin(renderer, button);
+	free(tokens);
+}
+
+uint64_t
+xbm_hash(uint64_t hash, const char *theme_name)
+{
+	static const char *files[] = { "iconify.xbm", "max.xbm", "close.xbm" };
+	char path[4096];
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+		snprintf(path, sizeof(path), "%s/%s", theme_dir(theme_name),
+			files[i]);
+		hash = hash_file(hash, path);
 	}
+	return hash;
 }
 
 void
-xbm_load(struct theme *theme, struct wlr_renderer *r)
+xbm_load(struct theme *theme, struct theme_assets *assets,
+		struct atlas *atlas)
 {
-	parse_set_color(theme->window_active_button_iconify_unpressed_image_color);
-	load_button(r, "iconify.xbm", &theme->xbm_iconify_active_unpressed,
-		    iconify_button_normal);
-	parse_set_color(theme->window_active_button_max_unpressed_image_color);
-	load_button(r, "max.xbm", &theme->xbm_maximize_active_unpressed,
-		    max_button_normal);
-	parse_set_color(theme->window_active_button_close_unpressed_image_color);
-	load_button(r, "close.xbm", &theme->xbm_close_active_unpressed,
-		    close_button_normal);
+	float *colors[LAB_BUTTON_STATE_COUNT];
+	float scale = assets->scale;
+
+	colors[LAB_BUTTON_HOVER] = theme->window_active_button_hover_image_color;
+	colors[LAB_BUTTON_PRESSED] =
+		theme->window_active_button_pressed_image_color;
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_active_button_iconify_unpressed_image_color;
+	load_button(theme, atlas, scale, "iconify.xbm", iconify_button_normal,
+		colors, assets->xbm_iconify_active);
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_active_button_max_unpressed_image_color;
+	load_button(theme, atlas, scale, "max.xbm", max_button_normal,
+		colors, assets->xbm_maximize_active);
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_active_button_close_unpressed_image_color;
+	load_button(theme, atlas, scale, "close.xbm", close_button_normal,
+		colors, assets->xbm_close_active);
 
-	parse_set_color(theme->window_inactive_button_iconify_unpressed_image_color);
-	load_button(r, "iconify.xbm", &theme->xbm_iconify_inactive_unpressed,
-		    iconify_button_normal);
-	parse_set_color(theme->window_inactive_button_max_unpressed_image_color);
-	load_button(r, "max.xbm", &theme->xbm_maximize_inactive_unpressed,
-		    max_button_normal);
-	parse_set_color(theme->window_inactive_button_close_unpressed_image_color);
-	load_button(r, "close.xbm", &theme->xbm_close_inactive_unpressed,
-		    close_button_normal);
+	colors[LAB_BUTTON_HOVER] =
+		theme->window_inactive_button_hover_image_color;
+	colors[LAB_BUTTON_PRESSED] =
+		theme->window_inactive_button_pressed_image_color;
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_inactive_button_iconify_unpressed_image_color;
+	load_button(theme, atlas, scale, "iconify.xbm", iconify_button_normal,
+		colors, assets->xbm_iconify_inactive);
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_inactive_button_max_unpressed_image_color;
+	load_button(theme, atlas, scale, "max.xbm", max_button_normal,
+		colors, assets->xbm_maximize_inactive);
+	colors[LAB_BUTTON_UNPRESSED] =
+		theme->window_inactive_button_close_unpressed_image_color;
+	load_button(theme, atlas, scale, "close.xbm", close_button_normal,
+		colors, assets->xbm_close_inactive);
 }
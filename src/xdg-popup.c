@@ -27,14 +27,19 @@ static void
 handle_xdg_popup_map(struct wl_listener *listener, void *data)
 {
 	struct xdg_popup *popup = wl_container_of(listener, popup, map);
-	damage_all_outputs(popup->view_child.parent->server);
+	view_surface_enter_outputs(popup->view_child.parent,
+		popup->wlr_popup->base->surface);
+	view_update_regions(popup->view_child.parent);
+	view_child_damage(&popup->view_child, true);
 }
 
 static void
 handle_xdg_popup_unmap(struct wl_listener *listener, void *data)
 {
 	struct xdg_popup *popup = wl_container_of(listener, popup, unmap);
-	damage_all_outputs(popup->view_child.parent->server);
+	view_update_regions(popup->view_child.parent);
+	view_child_damage(&popup->view_child, true);
+	view_child_damage_unmap(&popup->view_child);
 }
 
 static void
@@ -54,11 +59,10 @@ popup_handle_new_xdg_popup(struct wl_listener *listener, void *data)
 }
 
 static void
-popup_unconstrain(struct xdg_popup *popup)
+popup_unconstrain(struct view *view, struct wlr_xdg_popup *wlr_popup)
 {
-	struct view *view = popup->view_child.parent;
 	struct server *server = view->server;
-	struct wlr_box *popup_box = &popup->wlr_popup->geometry;
+	struct wlr_box *popup_box = &wlr_popup->geometry;
 	struct wlr_output_layout *output_layout = server->output_layout;
 	struct wlr_output *wlr_output = wlr_output_layout_output_at(
 		output_layout, view->x + popup_box->x, view->y + popup_box->y);
@@ -71,8 +75,7 @@ popup_unconstrain(struct xdg_popup *popup)
 		.width = output_box->width,
 		.height = output_box->height,
 	};
-	wlr_xdg_popup_unconstrain_from_box(
-		popup->wlr_popup, &output_toplevel_box);
+	wlr_xdg_popup_unconstrain_from_box(wlr_popup, &output_toplevel_box);
 }
 
 void
@@ -84,6 +87,8 @@ xdg_popup_create(struct view *view, struct wlr_xdg_popup *wlr_popup)
 	}
 
 	popup->wlr_popup = wlr_popup;
+	/* before view_child_init() so that it sees the final position */
+	popup_unconstrain(view, wlr_popup);
 	view_child_init(&popup->view_child, view, wlr_popup->base->surface);
 
 	popup->destroy.notify = handle_xdg_popup_destroy;
@@ -94,6 +99,4 @@ xdg_popup_create(struct view *view, struct wlr_xdg_popup *wlr_popup)
 	wl_signal_add(&wlr_popup->base->events.unmap, &popup->unmap);
 	popup->new_popup.notify = popup_handle_new_xdg_popup;
 	wl_signal_add(&wlr_popup->base->events.new_popup, &popup->new_popup);
-
-	popup_unconstrain(popup);
 }
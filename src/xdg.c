@@ -1,6 +1,7 @@
 #include <assert.h>
 #include "labwc.h"
 #include "ssd.h"
+#include "trace.h"
 
 /*
  * xdg_popup_create() and subsurface_create() are only called for the
@@ -50,6 +51,9 @@ handle_commit(struct wl_listener *listener, void *data)
 
 	view->w = size.width;
 	view->h = size.height;
+	trace_view(view, TRACE_VIEW_COMMIT, view->w, view->h);
+	stats_commit(&view->stats, view->surface);
+	stats_configure_acked(&view->stats, view->xdg_surface->configure_serial);
 
 	/* padding changes with maximize/unmaximize */
 	view->padding.top = view->padding.bottom = size.y;
@@ -70,6 +74,8 @@ handle_commit(struct wl_listener *listener, void *data)
 		}
 	}
 	ssd_update_geometry(view);
+	view_update_regions(view);
+	view_update_outputs(view);
 	damage_view_part(view);
 }
 
@@ -77,6 +83,7 @@ static void
 handle_map(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, map);
+	trace_view(view, TRACE_VIEW_MAP, 0, 0);
 	view->impl->map(view);
 }
 
@@ -84,6 +91,7 @@ static void
 handle_unmap(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, unmap);
+	trace_view(view, TRACE_VIEW_UNMAP, 0, 0);
 	view->impl->unmap(view);
 }
 
@@ -95,7 +103,10 @@ handle_destroy(struct wl_listener *listener, void *data)
 		wlr_foreign_toplevel_handle_v1_destroy(view->toplevel_handle);
 	}
 	wl_list_remove(&view->link);
+	desktop_restack(view->server);
 	ssd_destroy(view);
+	pixman_region32_fini(&view->extents);
+	pixman_region32_fini(&view->opaque);
 	free(view);
 }
 
@@ -144,12 +155,15 @@ handle_set_title(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, set_title);
 	assert(view);
+	trace_view(view, TRACE_VIEW_SET_TITLE, 0, 0);
+	stats_title_changed(&view->stats);
 	view_update_title(view);
 }
 
 static void
 xdg_toplevel_view_configure(struct view *view, struct wlr_box geo)
 {
+	trace_view(view, TRACE_VIEW_CONFIGURE, geo.width, geo.height);
 	view->pending_move_resize.update_x = geo.x != view->x;
 	view->pending_move_resize.update_y = geo.y != view->y;
 	view->pending_move_resize.x = geo.x;
@@ -161,10 +175,12 @@ xdg_toplevel_view_configure(struct view *view, struct wlr_box geo)
 		(uint32_t)geo.width, (uint32_t)geo.height);
 	if (serial > 0) {
 		view->pending_move_resize.configure_serial = serial;
+		stats_configure_sent(&view->stats, serial);
 	} else if (view->pending_move_resize.configure_serial == 0) {
 		view->x = geo.x;
 		view->y = geo.y;
 		ssd_update_geometry(view);
+		view_update_regions(view);
 		damage_all_outputs(view->server);
 	}
 }
@@ -213,6 +229,19 @@ xdg_toplevel_view_maximize(struct view *view, bool maximized)
 	wlr_xdg_toplevel_set_maximized(view->xdg_surface, maximized);
 }
 
+static void
+xdg_toplevel_view_minimize(struct view *view, bool minimized)
+{
+	/*
+	 * xdg-shell has no minimized state, but the client can at least be
+	 * told that it is no longer active. It will not receive any frame
+	 * callbacks until restored.
+	 */
+	if (minimized) {
+		wlr_xdg_toplevel_set_activated(view->xdg_surface, false);
+	}
+}
+
 static bool
 istopmost(struct view *view)
 {
@@ -314,6 +343,10 @@ xdg_toplevel_view_map(struct view *view)
 	wl_signal_add(&view->surface->events.new_subsurface,
 		&view->new_subsurface);
 
+	view_update_regions(view);
+	view_update_outputs(view);
+	desktop_restack(view->server);
+	idle_update_inhibit(view->server);
 	desktop_focus_view(&view->server->seat, view);
 	damage_all_outputs(view->server);
 }
@@ -322,6 +355,10 @@ static void
 xdg_toplevel_view_unmap(struct view *view)
 {
 	view->mapped = false;
+	view_update_regions(view);
+	view_update_outputs(view);
+	desktop_restack(view->server);
+	idle_update_inhibit(view->server);
 	damage_all_outputs(view->server);
 	wl_list_remove(&view->commit.link);
 	wl_list_remove(&view->new_subsurface.link);
@@ -338,6 +375,7 @@ static const struct view_impl xdg_toplevel_view_impl = {
 	.move = xdg_toplevel_view_move,
 	.unmap = xdg_toplevel_view_unmap,
 	.maximize = xdg_toplevel_view_maximize,
+	.minimize = xdg_toplevel_view_minimize,
 };
 
 void
@@ -356,7 +394,8 @@ xdg_surface_new(struct wl_listener *listener, void *data)
 	view->type = LAB_XDG_SHELL_VIEW;
 	view->impl = &xdg_toplevel_view_impl;
 	view->xdg_surface = xdg_surface;
-	wl_list_init(&view->ssd.parts);
+	pixman_region32_init(&view->extents);
+	pixman_region32_init(&view->opaque);
 
 	view->map.notify = handle_map;
 	wl_signal_add(&xdg_surface->events.map, &view->map);
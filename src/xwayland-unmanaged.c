@@ -17,9 +17,26 @@ unmanaged_handle_commit(struct wl_listener *listener, void *data)
 	struct xwayland_unmanaged *unmanaged =
 		wl_container_of(listener, unmanaged, commit);
 	struct wlr_xwayland_surface *xsurface = unmanaged->xwayland_surface;
-	unmanaged->lx = xsurface->x;
-	unmanaged->ly = xsurface->y;
-	damage_all_outputs(unmanaged->server);
+	struct wlr_surface *surface = xsurface->surface;
+	stats_commit(&unmanaged->stats, surface);
+
+	/*
+	 * Moving or resizing uncovers what was below, so damage everything.
+	 * Otherwise (e.g. an animated tooltip) only damage what was drawn.
+	 */
+	if (unmanaged->lx != xsurface->x || unmanaged->ly != xsurface->y
+			|| surface->current.width != surface->previous.width
+			|| surface->current.height != surface->previous.height) {
+		unmanaged->lx = xsurface->x;
+		unmanaged->ly = xsurface->y;
+		damage_all_outputs(unmanaged->server);
+		return;
+	}
+	struct output *output;
+	wl_list_for_each (output, &unmanaged->server->outputs, link) {
+		output_damage_surface(output, surface, unmanaged->lx,
+			unmanaged->ly, false);
+	}
 }
 
 static void
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include "labwc.h"
 #include "ssd.h"
+#include "trace.h"
 
 static void
 handle_commit(struct wl_listener *listener, void *data)
@@ -11,6 +12,10 @@ handle_commit(struct wl_listener *listener, void *data)
 	/* Must receive commit signal before accessing surface->current* */
 	view->w = view->surface->current.width;
 	view->h = view->surface->current.height;
+	trace_view(view, TRACE_VIEW_COMMIT, view->w, view->h);
+	stats_commit(&view->stats, view->surface);
+	/* X11 has no configure serials, so count the next commit as ack */
+	stats_configure_acked(&view->stats, 1);
 
 	if (view->pending_move_resize.update_x) {
 		view->x = view->pending_move_resize.x +
@@ -23,6 +28,8 @@ handle_commit(struct wl_listener *listener, void *data)
 		view->pending_move_resize.update_y = false;
 	}
 	ssd_update_geometry(view);
+	view_update_regions(view);
+	view_update_outputs(view);
 	damage_view_whole(view);
 }
 
@@ -30,6 +37,7 @@ static void
 handle_map(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, map);
+	trace_view(view, TRACE_VIEW_MAP, 0, 0);
 	view->impl->map(view);
 }
 
@@ -37,6 +45,7 @@ static void
 handle_unmap(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, unmap);
+	trace_view(view, TRACE_VIEW_UNMAP, 0, 0);
 	view->impl->unmap(view);
 }
 
@@ -48,12 +57,15 @@ handle_destroy(struct wl_listener *listener, void *data)
 		wlr_foreign_toplevel_handle_v1_destroy(view->toplevel_handle);
 	}
 	wl_list_remove(&view->link);
+	desktop_restack(view->server);
 	wl_list_remove(&view->map.link);
 	wl_list_remove(&view->unmap.link);
 	wl_list_remove(&view->destroy.link);
 	wl_list_remove(&view->request_configure.link);
 	wl_list_remove(&view->request_maximize.link);
 	ssd_destroy(view);
+	pixman_region32_fini(&view->extents);
+	pixman_region32_fini(&view->opaque);
 	free(view);
 }
 
@@ -81,12 +93,16 @@ handle_set_title(struct wl_listener *listener, void *data)
 {
 	struct view *view = wl_container_of(listener, view, set_title);
 	assert(view);
+	trace_view(view, TRACE_VIEW_SET_TITLE, 0, 0);
+	stats_title_changed(&view->stats);
 	view_update_title(view);
 }
 
 static void
 configure(struct view *view, struct wlr_box geo)
 {
+	trace_view(view, TRACE_VIEW_CONFIGURE, geo.width, geo.height);
+	stats_configure_sent(&view->stats, 1);
 	view->pending_move_resize.update_x = geo.x != view->x;
 	view->pending_move_resize.update_y = geo.y != view->y;
 	view->pending_move_resize.x = geo.x;
@@ -198,6 +214,10 @@ map(struct view *view)
 		      &view->commit);
 	view->commit.notify = handle_commit;
 
+	view_update_regions(view);
+	view_update_outputs(view);
+	desktop_restack(view->server);
+	idle_update_inhibit(view->server);
 	desktop_focus_view(&view->server->seat, view);
 	damage_all_outputs(view->server);
 }
@@ -206,6 +226,10 @@ static void
 unmap(struct view *view)
 {
 	view->mapped = false;
+	view_update_regions(view);
+	view_update_outputs(view);
+	desktop_restack(view->server);
+	idle_update_inhibit(view->server);
 	damage_all_outputs(view->server);
 	wl_list_remove(&view->commit.link);
 	desktop_focus_topmost_mapped_view(view->server);
@@ -217,6 +241,12 @@ maximize(struct view *view, bool maximized)
 	wlr_xwayland_surface_set_maximized(view->xwayland_surface, maximized);
 }
 
+static void
+minimize(struct view *view, bool minimized)
+{
+	wlr_xwayland_surface_set_minimized(view->xwayland_surface, minimized);
+}
+
 static const struct view_impl xwl_view_impl = {
 	.configure = configure,
 	.close = _close,
@@ -225,7 +255,8 @@ static const struct view_impl xwl_view_impl = {
 	.map = map,
 	.move = move,
 	.unmap = unmap,
-	.maximize = maximize
+	.maximize = maximize,
+	.minimize = minimize,
 };
 
 void
@@ -250,7 +281,8 @@ xwayland_surface_new(struct wl_listener *listener, void *data)
 	view->type = LAB_XWAYLAND_VIEW;
 	view->impl = &xwl_view_impl;
 	view->xwayland_surface = xsurface;
-	wl_list_init(&view->ssd.parts);
+	pixman_region32_init(&view->extents);
+	pixman_region32_init(&view->opaque);
 
 	view->map.notify = handle_map;
 	wl_signal_add(&xsurface->events.map, &view->map);